@@ -32,4 +32,11 @@ today = str(datetime.date.today())
 with open("include/version.h", "w") as f:
     f.write(f'#define FW_VERSION "{version}"\n')
     f.write(f'#define FW_RELEASE "{release}"\n')
-    f.write(f'#define FW_DATE "{today}"\n')
\ No newline at end of file
+    f.write(f'#define FW_DATE "{today}"\n')
+
+# --- PERF_LOG: count heap allocations (see include/heap_count.h) ---
+build_flags = env.GetProjectOption("build_flags", [])
+if isinstance(build_flags, list):
+    build_flags = " ".join(build_flags)
+if "-DPERF_LOG" in build_flags:
+    env.Append(LINKFLAGS=["-Wl,--wrap=malloc", "-Wl,--wrap=calloc", "-Wl,--wrap=realloc"])
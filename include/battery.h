@@ -0,0 +1,36 @@
+#ifndef BATTERY_H
+#define BATTERY_H
+
+#include <Arduino.h>
+
+#define BATT_PIN 3 // ADC1_CH2 (XIAO pad D2). MUST be ADC1 (GPIO1-10): ADC2 fails while BLE is on.
+
+// Battery sense via a 2:1 divider (measured pin mV * BATT_DIVIDER = battery mV).
+#define BATT_DIVIDER 2.0f
+#define BATT_VALID_MIN_MV 2800 // below this = USB-powered / no live cell -> no reading
+#define BATT_VALID_MAX_MV 4350 // above this = implausible -> ignore
+
+// The ADC runs in continuous (DMA) mode at its lowest rate, but only in short
+// bursts: a running conversion holds the driver's APB_FREQ_MAX lock, which
+// would keep the clock up and rule out light sleep between reads. One
+// batteryPoll() starts a burst, the next drains it into a ring and stops the
+// ADC. Each full ring is reduced to its median (drops radio-burst spikes) and
+// fed into an EMA, so readings cost no CPU time beyond a copy and a 64-entry
+// nth_element.
+#define BATT_RING 64
+#define BATT_EMA_SHIFT 4  // weight 1/16 per ring
+#define BATT_BURST_MS 120  // one ring at the slowest sample rate (~611 Hz)
+
+void batteryBegin();  // slow: primes the filter; run from the boot task
+void batteryStop();   // before deep sleep
+// non-blocking; returns how soon (ms) it wants calling again to finish a
+// burst, or 0 once the reading is up to date
+uint32_t batteryPoll();
+bool batterySampling();  // a burst is running (no light sleep)
+
+int batteryPinMv();   // median of the last ring, for calibration
+int batteryMv();      // filtered cell voltage; 0 until the first ring
+// state of charge from a Li-ion discharge curve, or -1 on USB / no cell
+int batteryPercent();
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+
+// Line-based command console on the USB CDC serial port. A command is a name,
+// optional space-separated arguments and a newline; handlers print their own
+// reply. Used for bench/debug tooling from a host (see tools/).
+struct ConsoleCommand {
+    const char* name;
+    void (*run)(const char* args);
+};
+
+// Binary frames share the port with text commands. A frame starts with
+// CONSOLE_FRAME_SOF at the start of a line, which no text command can begin
+// with:
+//   SOF | version | cmd | length (u16 LE) | payload | CRC32 (LE) of version..payload
+// Replies use the same framing (see tools/ttcfg.py). A frame that stalls for
+// CONSOLE_FRAME_TIMEOUT_MS is dropped.
+#define CONSOLE_FRAME_SOF 0xA5
+#define CONSOLE_FRAME_VERSION 1
+#define CONSOLE_FRAME_MAX 512  // payload bytes
+#define CONSOLE_FRAME_TIMEOUT_MS 500
+
+// called with a complete frame whose CRC and version checked out
+typedef void (*ConsoleFrameHandler)(uint8_t cmd, const uint8_t* payload, uint16_t length);
+
+void consoleBegin();
+void consoleSetFrameHandler(ConsoleFrameHandler handler);
+void consoleSendFrame(uint8_t cmd, const uint8_t* payload, uint16_t length);
+
+// Non-blocking: consumes whatever bytes are pending and dispatches each
+// complete line to the matching command. Call from loop().
+void consolePoll(const ConsoleCommand* commands, uint8_t count);
+
+// A USB host is on the bus, whether or not the HID interface has been started:
+// it sends a start-of-frame packet every millisecond, so the Serial/JTAG
+// frame counter has moved within the last CONSOLE_SOF_GAP_MS.
+#define CONSOLE_SOF_GAP_MS 3
+bool consoleHostPresent();
+
+// notify runs on the USB driver's event task whenever bytes arrive, so a
+// loop blocked in a long wait can pick them up at once
+void consoleOnInput(void (*notify)());
+
+#endif
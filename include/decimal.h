@@ -0,0 +1,61 @@
+#ifndef DECIMAL_H
+#define DECIMAL_H
+
+#include <Arduino.h>
+
+// 64-bit scaled decimal: value = raw / 10^DEC_FRAC_DIGITS. Add/subtract are
+// exact; multiply/divide use a 128-bit intermediate and round once, so 0.1 +
+// 0.2 is 0.3 and 7.25% tax on 19.99 carries no binary residue. Range is about
+// +/-9.2e12. Integer-only, so it avoids the ESP32-S3's soft-float doubles.
+#define DEC_FRAC_DIGITS 6
+#define DEC_SCALE 1000000LL
+
+struct Decimal {
+    int64_t raw;
+};
+
+enum DecRound {
+    DEC_ROUND_HALF_UP,    // ties away from zero (default, matches a paper tape)
+    DEC_ROUND_HALF_EVEN,  // ties to even (banker's rounding)
+    DEC_ROUND_DOWN,       // toward zero (truncate)
+    DEC_ROUND_UP,         // away from zero
+    DEC_ROUND_FLOOR,      // toward -infinity
+    DEC_ROUND_CEILING     // toward +infinity
+};
+
+#ifndef DEC_ROUND_DEFAULT
+#define DEC_ROUND_DEFAULT DEC_ROUND_HALF_UP
+#endif
+
+// mode used when a call doesn't pass one
+extern DecRound decRoundMode;
+
+inline Decimal decFromInt(int32_t v) { return Decimal{(int64_t)v * DEC_SCALE}; }
+inline bool decIsZero(Decimal v) { return v.raw == 0; }
+inline bool decIsInteger(Decimal v) { return v.raw % DEC_SCALE == 0; }
+
+// All arithmetic returns false on overflow (or division by zero) and leaves
+// *out untouched.
+bool decAdd(Decimal a, Decimal b, Decimal* out);
+bool decSub(Decimal a, Decimal b, Decimal* out);
+bool decMul(Decimal a, Decimal b, Decimal* out, DecRound mode = decRoundMode);
+bool decDiv(Decimal a, Decimal b, Decimal* out, DecRound mode = decRoundMode);
+
+// a * b / c with a single rounding step (e.g. amount * rate / 100)
+bool decMulDiv(Decimal a, Decimal b, Decimal c, Decimal* out, DecRound mode = decRoundMode);
+
+// round to `digits` fractional digits (0..DEC_FRAC_DIGITS)
+bool decRoundTo(Decimal v, uint8_t digits, Decimal* out, DecRound mode = decRoundMode);
+
+// "[-]digits[.digits][e[-]digits]"; an empty string is 0. Extra fractional
+// digits are rounded. False on malformed input or overflow.
+bool decParse(const char* s, Decimal* out, DecRound mode = decRoundMode);
+
+// plain notation with trailing fractional zeros trimmed; returns the length
+// (0 if `size` is too small, with out[0] = 0)
+size_t decFormat(Decimal v, char* out, size_t size);
+
+double decToDouble(Decimal v);
+bool decFromDouble(double d, Decimal* out);
+
+#endif
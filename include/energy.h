@@ -0,0 +1,50 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <Arduino.h>
+
+// Where the battery goes: time spent in each power-relevant state, kept in
+// RTC memory across deep sleeps, and an estimate of the charge each one used
+// from a per-state current coefficient. Rows overlap on purpose: the CPU rows
+// partition awake time, and the display, BLE and scan rows are what those
+// peripherals add on top. Deep sleep is measured with the RTC clock at wake.
+enum EnergyRow {
+    ENERGY_CPU_ACTIVE,  // max clock (power.h); all awake time on a fixed clock
+    ENERGY_CPU_USB,     // APB held for a USB host
+    ENERGY_CPU_IDLE,    // min clock / light sleep
+    ENERGY_DISPLAY,     // OLED on
+    ENERGY_BLE_ADV,     // advertising or pairing window
+    ENERGY_BLE_CONN,    // connected
+    ENERGY_SCAN,        // matrix scanning (any awake time)
+    ENERGY_SLEEP,       // deep sleep
+    ENERGY_ROW_COUNT
+};
+
+// what loop() reports to energyTick() for the rows it can't see itself
+enum EnergyFlag : uint8_t {
+    ENERGY_FLAG_DISPLAY  = 1 << 0,
+    ENERGY_FLAG_BLE_ADV  = 1 << 1,
+    ENERGY_FLAG_BLE_CONN = 1 << 2
+};
+
+// totals up to the last deep sleep; the running session is added on read
+struct EnergyLedger {
+    uint64_t ms[ENERGY_ROW_COUNT];
+    int64_t sleptAt;  // RTC clock (us) when deep sleep started, 0 = none pending
+};
+
+// current per row in uA; persisted with the settings blob
+extern uint16_t energyUa[ENERGY_ROW_COUNT];
+
+void energyDefaults();           // the stock coefficients
+void energyWake();               // after rtcStateInit(): books the sleep just ended
+void energyTick(uint8_t flags);  // from loop(), with the peripherals' state
+void energySleep();              // from goToSleep(): folds the session into RTC
+void energyReset();
+
+const char* energyRowName(EnergyRow row);
+uint64_t energyRowMs(EnergyRow row);
+uint64_t energyRowUah(EnergyRow row);  // estimated charge, uAh
+uint64_t energyTotalUah();
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef EXPR_H
+#define EXPR_H
+
+#include <Arduino.h>
+#include "decimal.h"
+
+// The calculator's entry tape: numbers and operators in the order they were
+// keyed, kept in a fixed arena and evaluated with normal precedence (so
+// 2+3*4 is 14) only when '=' is pressed. Evaluation is a single shunting-yard
+// pass, O(tokens), with its stacks on the C stack.
+#define EXPR_TOKEN_MAX 24  // number/operator pairs alternate, so 12 operands
+
+struct ExprToken {
+    Decimal value;
+    char op;  // 0 for a number, else + - * /
+};
+
+struct Expr {
+    ExprToken tokens[EXPR_TOKEN_MAX];
+    uint8_t count;
+};
+
+void exprClear(Expr* e);
+inline bool exprIsEmpty(const Expr* e) { return e->count == 0; }
+inline bool exprEndsWithOp(const Expr* e) { return e->count > 0 && e->tokens[e->count - 1].op; }
+
+// room for another operand and operator
+inline bool exprHasRoom(const Expr* e) { return e->count + 2 <= EXPR_TOKEN_MAX; }
+
+// append "operand op"; false (and unchanged) when the arena is full
+bool exprPush(Expr* e, Decimal operand, char op);
+
+// swap the trailing operator (the user changed their mind)
+void exprSetOp(Expr* e, char op);
+
+// Evaluate the tape, with `last` as the final operand. A trailing operator is
+// dropped when `last` is null. False on overflow; x/0 is 0 as before.
+bool exprEvaluate(const Expr* e, const Decimal* last, Decimal* out);
+
+// a op b with the calculator's rules
+bool exprApply(Decimal a, char op, Decimal b, Decimal* out);
+
+// The tape as text ("12+3*4-"), keeping the most recent part and marking a
+// cut with ".." when it exceeds `width` characters. `out` holds width + 1.
+size_t exprFormat(const Expr* e, char* out, size_t width);
+
+#endif
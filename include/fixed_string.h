@@ -0,0 +1,77 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+
+// Inline, fixed-capacity string for state that changes on every keystroke.
+// Unlike Arduino String it never touches the heap: storage is N chars plus the
+// terminator, and appends past capacity are dropped (and reported as false).
+template <size_t N>
+class FixedString {
+public:
+    FixedString() { clear(); }
+    FixedString(const char* s) { assign(s); }
+
+    FixedString& operator=(const char* s) { assign(s); return *this; }
+    FixedString& operator=(char c) { clear(); append(c); return *this; }
+    FixedString& operator+=(char c) { append(c); return *this; }
+    FixedString& operator+=(const char* s) { append(s); return *this; }
+
+    void clear() {
+        len_ = 0;
+        buf_[0] = 0;
+    }
+
+    void assign(const char* s) {
+        clear();
+        append(s);
+    }
+
+    bool append(char c) {
+        if (len_ >= N) return false;
+        buf_[len_++] = c;
+        buf_[len_] = 0;
+        return true;
+    }
+
+    bool append(const char* s) {
+        while (*s) {
+            if (!append(*s++)) return false;
+        }
+        return true;
+    }
+
+    // printf into the buffer (replacing its contents), truncating at capacity
+    __attribute__((format(printf, 2, 3)))
+    void format(const char* fmt, ...) {
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf_, N + 1, fmt, ap);
+        va_end(ap);
+        len_ = (n < 0) ? 0 : ((size_t)n > N ? N : (size_t)n);
+        buf_[len_] = 0;
+    }
+
+    void removeLast() {
+        if (len_ > 0) buf_[--len_] = 0;
+    }
+
+    int indexOf(char c) const {
+        const char* p = strchr(buf_, c);
+        return p ? (int)(p - buf_) : -1;
+    }
+
+    size_t length() const { return len_; }
+    static size_t capacity() { return N; }
+    const char* c_str() const { return buf_; }
+    bool operator==(const char* s) const { return strcmp(buf_, s) == 0; }
+
+    long toInt() const { return strtol(buf_, nullptr, 10); }
+    double toDouble() const { return strtod(buf_, nullptr); }
+
+private:
+    char buf_[N + 1];
+    size_t len_;
+};
+
+#endif
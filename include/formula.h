@@ -0,0 +1,46 @@
+#ifndef FORMULA_H
+#define FORMULA_H
+
+#include <Arduino.h>
+#include "decimal.h"
+
+// User-defined macros: an infix formula over parameters p0..p3, e.g.
+// "p0*(1+p1/100)+p2", compiled once to a small stack bytecode and stored in
+// NVS. Evaluation runs on a fixed Decimal stack; no heap, no recursion.
+#define FORMULA_MAX 4          // user formulas, after the built-in macros
+#define FORMULA_NAME_MAX 5     // fits the bottom bar next to the icons
+#define FORMULA_CODE_MAX 48    // bytes of bytecode
+#define FORMULA_STACK_MAX 8    // evaluation stack depth
+#define FORMULA_PARAM_MAX 4
+
+struct Formula {
+    char name[FORMULA_NAME_MAX + 1];
+    uint8_t paramCount;
+    uint8_t stackDepth;
+    uint8_t codeLen;
+    uint8_t code[FORMULA_CODE_MAX];
+};
+
+extern Formula formulas[FORMULA_MAX];
+extern uint8_t formulaCount;
+
+// Compile `text` into `out`. Returns nullptr on success, else a short error.
+const char* formulaCompile(const char* text, Formula* out);
+
+// run with params[0..paramCount); false on overflow, x/0 or bad bytecode
+bool formulaRun(const Formula* f, const Decimal* params, Decimal* out);
+
+// NVS ("t2" keys fml0..fml3)
+void formulaLoadAll();
+void formulaSaveAll();
+void formulaClearAll();  // RAM only; factory reset wipes the keys
+
+// add or replace by name; false when all slots are taken
+bool formulaStore(const Formula* f);
+
+// remove by name; returns its position, or -1 if not found
+int formulaRemove(const char* name);
+
+int formulaFind(const char* name);
+
+#endif
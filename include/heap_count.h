@@ -0,0 +1,13 @@
+#ifndef HEAP_COUNT_H
+#define HEAP_COUNT_H
+
+#include <Arduino.h>
+
+// PERF_LOG builds link malloc/calloc/realloc through counting wrappers
+// (build_scripts.py adds the -Wl,--wrap flags). Read the counter before and
+// after a code path to see how many heap allocations it made.
+#ifdef PERF_LOG
+extern volatile uint32_t heapAllocCount;
+#endif
+
+#endif
@@ -7,7 +7,18 @@ extern bool hidInitialized;
 
 void hidInit();
 void hidSendKey(char key, bool numLockOn = true);
-void hidSendString(const String& str);
+void hidSendString(const char* str);
 void hidSendNumpadKey(char key, bool numLockOn = true);
+bool hidUsbMounted();
+
+// Every send is a job for the HID task (tasks.h), so the pacing delays never
+// block the caller: hidSendKey()/hidSendString() only wait for queue room,
+// hidQueueString() is all-or-nothing (false if it doesn't fit), and
+// hidFlush() waits until the task has sent everything. The task holds the
+// max-clock power lock while it works through a run of jobs.
+void hidBegin();  // the queue and task; before any send
+bool hidQueueString(const char* str);
+void hidFlush();
+bool hidBusy();  // jobs queued or being sent
 
 #endif
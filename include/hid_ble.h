@@ -33,7 +33,8 @@ bool hidBleDeleteBond(uint8_t index);
 void hidBleSendNumpadKey(char key, bool numLockOn);
 
 // Type a string as ASCII.
-void hidBleSendString(const String& str);
+void hidBleSendString(const char* str);
+void hidBleTypeChar(char c);
 
 // Send an all-zeros HID report. Used to clear any stuck modifier/key bits
 // after connection or pairing — some hosts (macOS notably) latch a phantom
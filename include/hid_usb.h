@@ -5,6 +5,8 @@
 
 void hidUsbInit();
 void hidUsbSendNumpadKey(char key, bool numLockOn);
-void hidUsbSendString(const String& str);
+void hidUsbSendString(const char* str);
+void hidUsbTypeChar(char c);  // one press/release, no pacing delay
+bool hidUsbIsMounted();       // a host has enumerated us
 
 #endif
@@ -2,6 +2,7 @@
 #define MACROS_H
 
 #include <Arduino.h>
+#include "decimal.h"
 
 enum MacroState {
     MACRO_IDLE,
@@ -10,37 +11,61 @@ enum MacroState {
     MACRO_COMPLETE
 };
 
+#define MACRO_PARAM_MAX 4
+
+// One registry entry. compute() gets paramCount values in prompt order and
+// returns false on overflow (or division by zero). A stream macro never
+// completes: every entry goes to compute() and the prompt stays up.
+typedef bool (*MacroCompute)(const Decimal* params, Decimal* out);
+
+struct MacroDef {
+    const char* name;
+    const char* const* prompts;
+    uint8_t paramCount;
+    MacroCompute compute;
+    bool stream;
+};
+
 struct MacroContext {
     MacroState state;
-    String functionName;
-    double params[4];
+    uint8_t index;  // into MACROS; meaningful while awaiting input
+    Decimal params[MACRO_PARAM_MAX];
     uint8_t paramIndex;
     uint8_t paramCount;
-    double result;
+    Decimal result;
+    bool failed;  // result overflowed (or divided by zero); result is 0
+    bool stream;  // MacroDef::stream of the running macro
+    bool batch;   // keep running on new amounts instead of completing
+    bool batchPinned;  // params after the first are fixed from the first run
+    uint16_t batchCount;  // results produced in this batch
 };
 
 extern MacroContext macro;
 
-void macroStart(const char* name); // call this when user selects a macro
-bool macroInput(double value); // call this when user hits enter with a number returns true if macro is complete and result is ready
+void macroStart(uint8_t index); // call this when user selects a macro
+void macroStartBatch(uint8_t index);  // same, but each later entry reruns it on a new amount
+bool macroInput(Decimal value); // call this when user hits enter with a number returns true if macro is complete and result is ready (in batch mode, stays awaiting input)
 void macroCancel();
 const char* macroGetPrompt(); // prompt text for current param
 
-// menu
-extern const char* MACRO_NAMES[];
+// registry, in menu order (quick binds store these indices). Built-ins come
+// first; user formulas (formula.h) follow at MACRO_COUNT and up.
+extern const MacroDef MACROS[];
 extern const uint8_t MACRO_COUNT;
+uint8_t macroCount();  // built-ins plus user formulas
+const char* macroName(uint8_t index);
+
+// What gets stored (quick binds, the RTC session) is a reference, not a
+// registry index: built-ins by index, user formulas as MACRO_REF_FORMULA +
+// their formula slot, so a built-in added in an update doesn't shift them.
+#define MACRO_REF_NONE -1
+#define MACRO_REF_FORMULA 100
+int8_t macroRef(uint8_t index);
+int macroFromRef(int8_t ref);  // registry index, or -1 if none or stale
 extern uint8_t menuIndex;
 void macroMenuOpen();
 void macroMenuUp();
 void macroMenuDown();
 void macroMenuSelect();
 
-// MACRO LIST
-void macroTaxAdd();       // add tax: amount * (1 + rate)
-void macroTaxSub();       // remove tax: amount / (1 + rate)
-void macroPercent();      // percentage: amount * (percent / 100)
-void macroMarkup();       // markup: cost * (1 + margin)
-void macroDiscount();     // discount: price * (1 - discount)
-void macroCompoundInt();  // compound interest: principal * (1 + rate)^periods
-
 #endif
\ No newline at end of file
@@ -0,0 +1,21 @@
+#ifndef NUMFMT_H
+#define NUMFMT_H
+
+#include <Arduino.h>
+#include "decimal.h"
+
+// Number-to-text for the display. Both formatters write into the caller's
+// buffer (which must hold width + 1 bytes), never allocate, and return the
+// length written.
+
+// Shortest digits that read back as exactly `v` (Grisu2), laid out in fixed
+// notation when that fits in `width` characters and in exponent notation
+// ("1.2345e-7") otherwise. When even that is too wide the digits are rounded
+// to fit, so round-tripping is only guaranteed for width >= 24.
+size_t fmtDouble(double v, char* out, size_t width);
+
+// Exact decimal text when it fits; otherwise fractional digits are rounded off
+// (with the given mode) and, as a last resort, exponent notation is used.
+size_t fmtDecimal(Decimal v, char* out, size_t width, DecRound mode = decRoundMode);
+
+#endif
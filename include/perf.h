@@ -0,0 +1,14 @@
+#ifndef PERF_H
+#define PERF_H
+
+#include <Arduino.h>
+
+// Build with -DPERF_LOG=1 to print timing and counter lines over the USB CDC
+// serial port. Compiles to nothing otherwise, so call sites can stay in place.
+#ifdef PERF_LOG
+#define PERF_PRINTF(...) Serial.printf(__VA_ARGS__)
+#else
+#define PERF_PRINTF(...) do {} while (0)
+#endif
+
+#endif
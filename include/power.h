@@ -0,0 +1,51 @@
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+// Dynamic frequency scaling while awake. With no lock held the CPU runs at
+// POWER_MIN_MHZ and, if the IDF build has tickless idle, light-sleeps through
+// loop()'s waits. Key handling, rendering and HID sends take the max-clock
+// lock for as long as they run. A mounted USB host holds the APB clock up
+// (the OTG stack needs it) and so rules out light sleep.
+//
+// All of that needs an ESP-IDF built with CONFIG_PM_ENABLE (and, for the
+// light sleep, CONFIG_FREERTOS_USE_TICKLESS_IDLE). The Arduino core's
+// prebuilt libraries have neither, so the stock PlatformIO envs run at a
+// fixed clock: esp_pm_configure() fails, powerScalingActive() is false and
+// the locks are no-ops. The idle ladder's explicit light sleep works either way.
+#define POWER_MIN_MHZ 40  // XTAL
+
+// why the CPU is at full clock; each has its own PM lock and counters
+enum PowerReason {
+    POWER_KEYS,
+    POWER_RENDER,
+    POWER_HID,
+    POWER_CONSOLE,  // "pm max": pinned for bench current measurements
+    POWER_REASON_COUNT
+};
+
+// mutually exclusive, for residency: what the clock tree is doing right now
+enum PowerState {
+    POWER_STATE_ACTIVE,  // max CPU clock
+    POWER_STATE_USB,     // APB held for USB, CPU otherwise idle
+    POWER_STATE_IDLE,    // min clock, light sleep allowed
+    POWER_STATE_COUNT
+};
+
+void powerBegin();
+void powerBoost(PowerReason reason);  // nests; every call needs a powerRelax()
+void powerRelax(PowerReason reason);
+void powerSetUsbMounted(bool mounted);
+
+bool powerScalingActive();  // false if the IDF build lacks CONFIG_PM_ENABLE
+bool powerLightSleepActive();
+uint32_t powerMaxMhz();  // top of the scaling range
+PowerState powerState();
+const char* powerReasonName(PowerReason reason);
+const char* powerStateName(PowerState state);
+uint32_t powerReasonCount(PowerReason reason);  // boosts taken since boot
+uint64_t powerReasonMicros(PowerReason reason); // time held (reasons overlap)
+uint64_t powerStateMicros(PowerState state);    // residency, up to now
+
+#endif
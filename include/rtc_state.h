@@ -0,0 +1,62 @@
+#ifndef RTC_STATE_H
+#define RTC_STATE_H
+
+#include <Arduino.h>
+#include "decimal.h"
+#include "expr.h"
+#include "stats.h"
+#include "formula.h"
+#include "energy.h"
+
+// State kept in RTC slow memory, which survives deep sleep (not power loss or
+// reset). A CRC over the block tells a warm wake from a fresh one, so setup()
+// can pick up where the user left off in microseconds without touching NVS.
+#define HISTORY_MAX 16
+#define RTC_CONFIG_MAX 128  // room for main.cpp's SettingsBlob
+
+// the calculator as it was when goToSleep() ran
+struct RtcSession {
+    bool valid;
+    bool newEntry;
+    char displayValue[33];
+    Decimal displayExact;  // full-precision value behind a shown result
+    bool displayExactValid;
+    char functionName[16];
+    Expr expr;
+    int8_t macroRef;  // macroRef() of a macro awaiting input, MACRO_REF_NONE if none
+    uint8_t macroParamIndex;
+    Decimal macroParams[4];
+    bool macroBatch;
+    bool macroBatchPinned;
+    uint16_t macroBatchCount;
+};
+
+struct RtcState {
+    Decimal history[HISTORY_MAX];  // ring of results, newest at historyHead - 1
+    uint8_t historyHead;
+    uint8_t historyCount;
+    RtcSession session;
+    Decimal memory;  // the M register; NVS holds a lazily written copy
+    Stats stats;     // the stats-mode column (stats.h)
+    EnergyLedger energy;  // per-state residency (energy.h)
+    // resolved config as of the last sleep, so a key wake skips NVS entirely
+    bool configValid;
+    uint8_t config[RTC_CONFIG_MAX];
+    Formula formulas[FORMULA_MAX];
+    uint8_t formulaCount;
+    uint32_t crc;
+};
+
+extern RtcState rtcState;
+
+// Check the block on boot. True if it survived; otherwise it is zeroed.
+bool rtcStateInit();
+
+// recompute the CRC after writing to rtcState directly
+void rtcStateSeal();
+
+void historyPush(Decimal v);
+inline uint8_t historyCount() { return rtcState.historyCount; }
+Decimal historyGet(uint8_t age);  // 0 = newest
+
+#endif
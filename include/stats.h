@@ -0,0 +1,58 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+#include "decimal.h"
+
+// Running statistics over a column of entries. Each value updates the
+// accumulators in O(1) time and space (Welford's method, so the variance
+// doesn't cancel away over thousands of entries). The regression is of value
+// on entry number 1, 2, 3..., i.e. the trend down the column. The block lives
+// in RTC memory next to the history, so a column survives deep sleep.
+struct Stats {
+    uint32_t count;
+    Decimal sum;  // exact, like chaining '+'
+    bool sumOverflow;
+    Decimal min;
+    Decimal max;
+    double mean;   // of the values
+    double m2;     // sum of squared deviations from the mean
+    double meanX;  // of the entry numbers
+    double m2X;
+    double cXY;    // co-moment of entry number and value
+};
+
+enum StatKind {
+    STAT_COUNT,
+    STAT_SUM,
+    STAT_MEAN,
+    STAT_STDDEV,  // sample (n - 1)
+    STAT_MIN,
+    STAT_MAX,
+    STAT_SLOPE,
+    STAT_INTERCEPT,
+    STAT_MEDIAN,  // these two need the raw values kept in PSRAM
+    STAT_P90,
+    STAT_RESET,   // not a value: recalling it clears the column
+    STAT_KIND_COUNT
+};
+
+// up to this many raw values are kept in PSRAM for the median/percentile
+#define STATS_RAW_MAX 65536
+
+void statsClear();
+void statsAdd(Decimal v);
+uint32_t statsCount();
+const char* statsLabel(StatKind kind);
+
+// The stat the UI shows. A median or percentile is an O(n) pass over the raw
+// values (which reorders them), so it is worked out here and after each
+// statsAdd() while selected, never when the value is read.
+void statsSelect(StatKind kind);
+
+// false when undefined: no entries, stddev of one value, sum overflow, or
+// median/percentile without every raw value in PSRAM (none fitted, or deep
+// sleep powered it off) or that isn't the selected stat
+bool statsValue(StatKind kind, double* out);
+
+#endif
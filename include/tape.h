@@ -0,0 +1,33 @@
+#ifndef TAPE_H
+#define TAPE_H
+
+#include <Arduino.h>
+#include "decimal.h"
+
+// Adding-machine tape: every operand, operator and result, appended in order.
+// Lines are 9 bytes packed, kept in a PSRAM arena (1 MB = 116508 lines); once
+// it's full the oldest lines roll off. Boards without PSRAM get a short tape
+// in internal RAM. PSRAM is powered down in deep sleep, so the tape starts
+// over on wake, unlike the history.
+#define TAPE_ARENA_BYTES (1024 * 1024)
+#define TAPE_FALLBACK_LINES 128
+
+// tags: '+' '-' '*' '/' an operand and the operator that followed it,
+// '=' the last operand of an expression, 'T' a result, 'P' a macro entry
+struct __attribute__((packed)) TapeLine {
+    int64_t raw;  // Decimal.raw
+    char tag;
+};
+
+void tapeAppend(Decimal value, char tag);
+void tapeRetag(char tag);  // operator swapped before the next operand
+void tapeClear();
+uint32_t tapeCount();   // lines held
+uint32_t tapeTotal();   // lines ever appended, i.e. the newest line's number
+uint32_t tapeCapacity();
+TapeLine tapeGet(uint32_t age);  // 0 = newest; age < tapeCount()
+
+// "line,value,op" CSV, oldest first, written in large chunks; returns bytes
+size_t tapeExportCsv(Print& out);
+
+#endif
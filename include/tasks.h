@@ -0,0 +1,37 @@
+#ifndef TASKS_H
+#define TASKS_H
+
+#include <Arduino.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// The firmware's FreeRTOS tasks, their priority and core, and a busy-time
+// and stack report for each. Matrix scanning and the UI share core 1 with
+// scanning above the UI, so a key is never stuck behind a render; HID sends
+// (with their pacing delays) and the BLE link watch run on core 0 beside the
+// radio stack. They talk through queues: scan -> UI key events, BLE -> UI
+// link events, UI -> HID jobs.
+enum AppTask : uint8_t {
+    TASK_SCAN,  // matrix scan, posts key events
+    TASK_UI,    // Arduino's loopTask: keys, display, timers, console
+    TASK_HID,   // USB/BLE sends
+    TASK_BLE,   // link state watch
+    TASK_COUNT
+};
+
+// create a task from its row in the table and register it (not TASK_UI)
+TaskHandle_t taskStart(AppTask task, TaskFunction_t fn);
+void taskRegister(AppTask task, TaskHandle_t handle);  // a task created elsewhere
+
+// bracket the work between blocking waits; the rest is the task's idle time
+void taskBusyBegin(AppTask task);
+void taskBusyEnd(AppTask task);
+
+const char* taskName(AppTask task);
+uint8_t taskCore(AppTask task);
+uint8_t taskPriority(AppTask task);
+uint16_t taskLoadPermille(AppTask task);  // busy share of the window since taskLoadReset()
+uint32_t taskStackFree(AppTask task);     // bytes of stack never touched (high-water mark)
+void taskLoadReset();
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <Arduino.h>
+
+// Deadlines for loop(): a binary min-heap of due times, one slot per timer
+// id, so re-arming an id just moves it. loop() sleeps until the earliest one
+// (or a key) instead of waking every 20 ms to compare millis() against each.
+// Times are millis() compared by signed difference, so wrap is harmless for
+// deadlines under ~24 days out.
+#define TIMER_MAX 16
+
+void timerArm(uint8_t id, uint32_t due);  // (re)schedule
+void timerCancel(uint8_t id);
+bool timerArmed(uint8_t id);
+int timerPopExpired(uint32_t now);  // an expired id (now disarmed), or -1
+// ms until the earliest deadline, 0 if one is already due, `cap` if none is sooner
+uint32_t timerWaitMs(uint32_t now, uint32_t cap);
+
+#endif
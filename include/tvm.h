@@ -0,0 +1,37 @@
+#ifndef TVM_H
+#define TVM_H
+
+#include <Arduino.h>
+
+// Time value of money, payments at the end of each period, with the usual
+// cash-flow signs (money received positive, money paid out negative):
+//
+//   pv * (1+i)^n + pmt * ((1+i)^n - 1) / i + fv = 0
+//
+// i is the periodic rate as a fraction (the macros show it in percent). PMT,
+// PV, FV and N have closed forms; the rate and IRR are found with Newton's
+// method, falling back to a bracketed Newton/bisection hybrid when a plain
+// Newton step leaves the domain or stalls. Every solve stops after
+// TVM_ITER_MAX iterations or TVM_BUDGET_US, whichever comes first, so a bad
+// input can't freeze the keypad. All functions return false when there's no
+// finite answer.
+#define TVM_ITER_MAX 60
+#define TVM_BUDGET_US 20000
+#define TVM_FLOW_MAX 16  // cash flows accepted by tvmIrr()
+
+struct TvmStats {
+    uint8_t iterations;  // function evaluations, bracketing included
+    bool bisected;       // needed the bracketed fallback
+    uint32_t micros;
+};
+
+bool tvmPmt(double n, double i, double pv, double fv, double* out);
+bool tvmPv(double n, double i, double pmt, double fv, double* out);
+bool tvmFv(double n, double i, double pv, double pmt, double* out);
+bool tvmN(double i, double pv, double pmt, double fv, double* out);
+bool tvmRate(double n, double pv, double pmt, double fv, double* out, TvmStats* stats = nullptr);
+
+// rate r with sum(flows[k] / (1+r)^k) = 0; flows[0] is the initial outlay
+bool tvmIrr(const double* flows, uint8_t count, double* out, TvmStats* stats = nullptr);
+
+#endif
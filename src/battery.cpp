@@ -0,0 +1,171 @@
+#include "battery.h"
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include <algorithm>
+
+#define BATT_CHANNEL ADC1_CHANNEL_2  // BATT_PIN
+#define DMA_FRAME_BYTES 256          // 64 results per DMA interrupt
+
+// resting cell voltage vs state of charge for a typical 1S Li-ion/LiPo at a
+// light load; interpolated linearly between points
+struct CurvePoint {
+    uint16_t mv;
+    uint8_t percent;
+};
+static const CurvePoint DISCHARGE_CURVE[] = {
+    {3300, 0}, {3500, 5}, {3600, 10}, {3680, 20}, {3730, 30}, {3770, 40},
+    {3800, 50}, {3830, 60}, {3870, 70}, {3930, 80}, {4000, 90}, {4080, 95}, {4200, 100}
+};
+#define CURVE_POINTS (sizeof(DISCHARGE_CURVE) / sizeof(DISCHARGE_CURVE[0]))
+
+static esp_adc_cal_characteristics_t adcChars;
+static bool dmaRunning = false;    // controller configured for continuous mode
+static bool dmaSampling = false;   // and converting: holds the driver's APB_FREQ_MAX lock
+static volatile bool ready = false;  // set once batteryBegin() is done
+
+static uint16_t ring[BATT_RING];  // raw ADC codes
+static uint8_t ringLen = 0;
+static int lastPinMv = 0;
+static int32_t emaScaled = 0;  // pin mV << BATT_EMA_SHIFT
+
+
+static bool startDma() {
+    adc_digi_init_config_t init = {};
+    init.max_store_buf_size = 4 * DMA_FRAME_BYTES;
+    init.conv_num_each_intr = DMA_FRAME_BYTES;
+    init.adc1_chan_mask = BIT(BATT_CHANNEL);
+    if (adc_digi_initialize(&init) != ESP_OK) return false;
+
+    adc_digi_pattern_config_t pattern = {};
+    pattern.atten = ADC_ATTEN_DB_11;  // ~0-3.1V; the divider keeps the pin <= ~2.1V
+    pattern.channel = BATT_CHANNEL;
+    pattern.unit = 0;  // ADC1
+    pattern.bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+
+    adc_digi_configuration_t config = {};
+    config.pattern_num = 1;
+    config.adc_pattern = &pattern;
+    config.sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_LOW;  // slowest the controller runs
+    config.conv_mode = ADC_CONV_SINGLE_UNIT_1;
+    config.format = ADC_DIGI_OUTPUT_FORMAT_TYPE2;
+    if (adc_digi_controller_configure(&config) != ESP_OK || adc_digi_start() != ESP_OK) {
+        adc_digi_deinitialize();
+        return false;
+    }
+    dmaSampling = true;
+    return true;
+}
+
+
+static void pauseDma() {
+    if (dmaSampling) adc_digi_stop();
+    dmaSampling = false;
+}
+
+
+// a full ring: median out, into the EMA
+static void filterRing() {
+    uint16_t sorted[BATT_RING];
+    memcpy(sorted, ring, sizeof(sorted));
+    std::nth_element(sorted, sorted + BATT_RING / 2, sorted + BATT_RING);
+    lastPinMv = dmaRunning ? esp_adc_cal_raw_to_voltage(sorted[BATT_RING / 2], &adcChars)
+                           : sorted[BATT_RING / 2];
+    if (emaScaled == 0) {
+        emaScaled = lastPinMv << BATT_EMA_SHIFT;
+    } else {
+        emaScaled += lastPinMv - (emaScaled >> BATT_EMA_SHIFT);
+    }
+    ringLen = 0;
+}
+
+
+static void pushSample(uint16_t sample) {
+    ring[ringLen++] = sample;
+    if (ringLen == BATT_RING) filterRing();
+}
+
+
+static void drain(uint32_t timeoutMs) {
+    if (!dmaRunning) {
+        // no DMA: a few one-shot reads per poll (already in mV)
+        for (int i = 0; i < 8; i++) pushSample(analogReadMilliVolts(BATT_PIN));
+        return;
+    }
+    uint8_t buf[DMA_FRAME_BYTES];
+    uint32_t got = 0;
+    esp_err_t err;
+    // polled every few seconds the driver's buffer has overflowed by then;
+    // that read still returns the frames it kept
+    while (((err = adc_digi_read_bytes(buf, sizeof(buf), &got, timeoutMs)) == ESP_OK
+            || err == ESP_ERR_INVALID_STATE) && got > 0) {
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got; i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t* r = (const adc_digi_output_data_t*)(buf + i);
+            if (r->type2.channel == BATT_CHANNEL) pushSample(r->type2.data);
+        }
+        timeoutMs = 0;  // only ever wait for the first frame
+    }
+}
+
+
+void batteryBegin() {
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcChars);
+    dmaRunning = startDma();
+    if (!dmaRunning) analogSetPinAttenuation(BATT_PIN, ADC_11db);
+    // the boot task can afford to wait for the first ring (~100 ms)
+    uint32_t start = millis();
+    while (emaScaled == 0 && millis() - start < 500) drain(50);
+    pauseDma();
+    ready = true;
+}
+
+
+void batteryStop() {
+    ready = false;
+    if (dmaRunning) {
+        pauseDma();
+        adc_digi_deinitialize();
+        dmaRunning = false;
+    }
+}
+
+
+uint32_t batteryPoll() {
+    if (!ready) return 0;
+    if (dmaRunning && !dmaSampling) {
+        dmaSampling = adc_digi_start() == ESP_OK;
+        if (dmaSampling) return BATT_BURST_MS;
+    }
+    drain(0);
+    pauseDma();
+    return 0;
+}
+
+
+bool batterySampling() {
+    return dmaSampling;
+}
+
+
+int batteryPinMv() {
+    return lastPinMv;
+}
+
+
+int batteryMv() {
+    return (int)((emaScaled >> BATT_EMA_SHIFT) * BATT_DIVIDER);
+}
+
+
+int batteryPercent() {
+    int mv = batteryMv();
+    if (mv < BATT_VALID_MIN_MV || mv > BATT_VALID_MAX_MV) return -1;
+    if (mv <= DISCHARGE_CURVE[0].mv) return 0;
+    for (uint8_t i = 1; i < CURVE_POINTS; i++) {
+        const CurvePoint& hi = DISCHARGE_CURVE[i];
+        if (mv < hi.mv) {
+            const CurvePoint& lo = DISCHARGE_CURVE[i - 1];
+            return lo.percent + (mv - lo.mv) * (hi.percent - lo.percent) / (hi.mv - lo.mv);
+        }
+    }
+    return 100;
+}
@@ -0,0 +1,157 @@
+#include "console.h"
+#include "esp_rom_crc.h"
+#include "soc/soc.h"
+#include "soc/usb_serial_jtag_reg.h"
+
+#define CONSOLE_LINE_MAX 96
+#define FRAME_HEADER 4  // version, cmd, length
+#define FRAME_CRC 4
+
+static char lineBuf[CONSOLE_LINE_MAX];
+static uint8_t lineLen = 0;
+static bool lineOverflow = false;
+
+static ConsoleFrameHandler frameHandler = nullptr;
+static uint8_t frameBuf[FRAME_HEADER + CONSOLE_FRAME_MAX + FRAME_CRC];
+static uint16_t frameLen = 0;
+static bool inFrame = false;
+static uint32_t frameStartedAt = 0;
+
+static void (*inputNotify)() = nullptr;
+
+
+void consoleBegin() {
+    Serial.begin(115200);
+}
+
+
+void consoleSetFrameHandler(ConsoleFrameHandler handler) {
+    frameHandler = handler;
+}
+
+
+bool consoleHostPresent() {
+    static uint32_t lastFrame = 0xFFFFFFFF;
+    static uint32_t movedAt = 0;
+    uint32_t now = millis();
+    // 11 bits wrap every 2048 ms; a read that lands exactly one wrap later
+    // misses the host for that one call
+    uint32_t frame = REG_GET_FIELD(USB_SERIAL_JTAG_FRAM_NUM_REG, USB_SERIAL_JTAG_SOF_FRAME_INDEX);
+    if (frame != lastFrame) {
+        lastFrame = frame;
+        movedAt = now;
+    }
+    return now - movedAt <= CONSOLE_SOF_GAP_MS;
+}
+
+
+static void onRxEvent(void* arg, esp_event_base_t base, int32_t id, void* data) {
+    (void)arg; (void)base; (void)id; (void)data;
+    if (inputNotify) inputNotify();
+}
+
+
+void consoleOnInput(void (*notify)()) {
+    inputNotify = notify;
+    Serial.onEvent(ARDUINO_HW_CDC_RX_EVENT, onRxEvent);
+}
+
+
+static uint32_t readLe32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+void consoleSendFrame(uint8_t cmd, const uint8_t* payload, uint16_t length) {
+    uint8_t header[1 + FRAME_HEADER] = {
+        CONSOLE_FRAME_SOF, CONSOLE_FRAME_VERSION, cmd, (uint8_t)length, (uint8_t)(length >> 8)
+    };
+    uint32_t crc = esp_rom_crc32_le(0, header + 1, FRAME_HEADER);
+    crc = esp_rom_crc32_le(crc, payload, length);
+    uint8_t trailer[FRAME_CRC] = {(uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24)};
+    Serial.write(header, sizeof(header));
+    Serial.write(payload, length);
+    Serial.write(trailer, sizeof(trailer));
+}
+
+
+// collect one frame byte; dispatches (or rejects) once the frame is complete
+static void frameByte(uint8_t c) {
+    frameBuf[frameLen++] = c;
+    if (frameLen < FRAME_HEADER) return;
+    uint16_t payloadLen = frameBuf[2] | (frameBuf[3] << 8);
+    if (payloadLen > CONSOLE_FRAME_MAX) {
+        inFrame = false;
+        Serial.println("ERR frame too long");
+        return;
+    }
+    if (frameLen < FRAME_HEADER + payloadLen + FRAME_CRC) return;
+    inFrame = false;
+
+    uint32_t crc = esp_rom_crc32_le(0, frameBuf, FRAME_HEADER + payloadLen);
+    if (crc != readLe32(frameBuf + FRAME_HEADER + payloadLen)) {
+        Serial.println("ERR frame crc");
+        return;
+    }
+    if (frameBuf[0] != CONSOLE_FRAME_VERSION || !frameHandler) {
+        Serial.println("ERR frame version");
+        return;
+    }
+    frameHandler(frameBuf[1], frameBuf + FRAME_HEADER, payloadLen);
+}
+
+
+static void dispatch(const ConsoleCommand* commands, uint8_t count) {
+    char* args = strchr(lineBuf, ' ');
+    if (args) {
+        *args++ = 0;
+        while (*args == ' ') args++;
+    } else {
+        args = lineBuf + lineLen;  // empty string
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        if (strcmp(lineBuf, commands[i].name) == 0) {
+            commands[i].run(args);
+            return;
+        }
+    }
+    Serial.printf("ERR unknown command '%s'\n", lineBuf);
+}
+
+
+void consolePoll(const ConsoleCommand* commands, uint8_t count) {
+    if (inFrame && millis() - frameStartedAt > CONSOLE_FRAME_TIMEOUT_MS) {
+        inFrame = false;
+        Serial.println("ERR frame timeout");
+    }
+    while (Serial.available() > 0) {
+        int c = Serial.read();
+        if (c < 0) break;
+        if (inFrame) {
+            frameByte((uint8_t)c);
+            continue;
+        }
+        if (c == CONSOLE_FRAME_SOF && lineLen == 0) {
+            inFrame = true;
+            frameLen = 0;
+            frameStartedAt = millis();
+            continue;
+        }
+        if (c == '\r' || c == '\n') {
+            if (lineOverflow) {
+                Serial.println("ERR line too long");
+            } else if (lineLen > 0) {
+                lineBuf[lineLen] = 0;
+                dispatch(commands, count);
+            }
+            lineLen = 0;
+            lineOverflow = false;
+            continue;
+        }
+        if (lineLen < CONSOLE_LINE_MAX - 1) {
+            lineBuf[lineLen++] = (char)c;
+        } else {
+            lineOverflow = true;
+        }
+    }
+}
@@ -0,0 +1,285 @@
+#include "decimal.h"
+
+DecRound decRoundMode = DEC_ROUND_DEFAULT;
+
+
+static uint64_t magnitude(int64_t v) {
+    return v < 0 ? (uint64_t)0 - (uint64_t)v : (uint64_t)v;
+}
+
+
+// q = floor(a * b / d), r = remainder, using a 128-bit product. False when the
+// quotient doesn't fit in 64 bits.
+static bool mulDivU64(uint64_t a, uint64_t b, uint64_t d, uint64_t* q, uint64_t* r) {
+    uint64_t aLo = (uint32_t)a, aHi = a >> 32;
+    uint64_t bLo = (uint32_t)b, bHi = b >> 32;
+    uint64_t ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+    uint64_t mid = (ll >> 32) + (uint32_t)lh + (uint32_t)hl;
+    uint64_t lo = (mid << 32) | (uint32_t)ll;
+    uint64_t hi = hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+
+    if (hi == 0) {
+        // common case: the product fits in 64 bits
+        *q = lo / d;
+        *r = lo % d;
+        return true;
+    }
+    if (hi >= d) return false;
+
+    // restoring shift-subtract division of hi:lo by d
+    uint64_t rem = hi, quo = 0;
+    for (int i = 63; i >= 0; i--) {
+        bool carry = rem >> 63;
+        rem = (rem << 1) | ((lo >> i) & 1);
+        quo <<= 1;
+        if (carry || rem >= d) {
+            rem -= d;
+            quo |= 1;
+        }
+    }
+    *q = quo;
+    *r = rem;
+    return true;
+}
+
+
+// apply the rounding mode to a truncated quotient q with remainder r of d
+static bool roundQuotient(uint64_t q, uint64_t r, uint64_t d, bool negative,
+                          DecRound mode, int64_t* out) {
+    if (r != 0) {
+        uint64_t rest = d - r;  // r vs rest compares the remainder against half of d
+        bool up = false;
+        switch (mode) {
+            case DEC_ROUND_HALF_UP:   up = r >= rest; break;
+            case DEC_ROUND_HALF_EVEN: up = r > rest || (r == rest && (q & 1)); break;
+            case DEC_ROUND_DOWN:      up = false; break;
+            case DEC_ROUND_UP:        up = true; break;
+            case DEC_ROUND_FLOOR:     up = negative; break;
+            case DEC_ROUND_CEILING:   up = !negative; break;
+        }
+        if (up) q++;
+    }
+    if (q > (uint64_t)INT64_MAX) return false;
+    *out = negative ? -(int64_t)q : (int64_t)q;
+    return true;
+}
+
+
+static bool mulDiv(int64_t a, int64_t b, int64_t d, DecRound mode, int64_t* out) {
+    if (d == 0) return false;
+    bool negative = (a < 0) != (b < 0);
+    if (d < 0) negative = !negative;
+    uint64_t q, r;
+    uint64_t dm = magnitude(d);
+    if (!mulDivU64(magnitude(a), magnitude(b), dm, &q, &r)) return false;
+    if (q == 0 && r == 0) negative = false;
+    return roundQuotient(q, r, dm, negative, mode, out);
+}
+
+
+bool decAdd(Decimal a, Decimal b, Decimal* out) {
+    int64_t sum;
+    if (__builtin_add_overflow(a.raw, b.raw, &sum) || sum == INT64_MIN) return false;
+    out->raw = sum;
+    return true;
+}
+
+
+bool decSub(Decimal a, Decimal b, Decimal* out) {
+    int64_t diff;
+    if (__builtin_sub_overflow(a.raw, b.raw, &diff) || diff == INT64_MIN) return false;
+    out->raw = diff;
+    return true;
+}
+
+
+bool decMul(Decimal a, Decimal b, Decimal* out, DecRound mode) {
+    int64_t raw;
+    if (!mulDiv(a.raw, b.raw, DEC_SCALE, mode, &raw)) return false;
+    out->raw = raw;
+    return true;
+}
+
+
+bool decDiv(Decimal a, Decimal b, Decimal* out, DecRound mode) {
+    int64_t raw;
+    if (!mulDiv(a.raw, DEC_SCALE, b.raw, mode, &raw)) return false;
+    out->raw = raw;
+    return true;
+}
+
+
+bool decMulDiv(Decimal a, Decimal b, Decimal c, Decimal* out, DecRound mode) {
+    // (A*S)(B*S)/(C*S) = (A*B/C)*S, so raw values can be used directly
+    int64_t raw;
+    if (!mulDiv(a.raw, b.raw, c.raw, mode, &raw)) return false;
+    out->raw = raw;
+    return true;
+}
+
+
+bool decRoundTo(Decimal v, uint8_t digits, Decimal* out, DecRound mode) {
+    if (digits >= DEC_FRAC_DIGITS) {
+        *out = v;
+        return true;
+    }
+    int64_t unit = 1;
+    for (uint8_t i = digits; i < DEC_FRAC_DIGITS; i++) unit *= 10;
+    int64_t units;
+    if (!mulDiv(v.raw, 1, unit, mode, &units)) return false;
+    int64_t raw;
+    if (__builtin_mul_overflow(units, unit, &raw)) return false;
+    out->raw = raw;
+    return true;
+}
+
+
+// rewrite "[-]d.ddde[-]x" in plain notation; false if malformed or too long
+static bool expandExponent(const char* s, const char* e, char* out, size_t size) {
+    char* p = out;
+    char* end = out + size - 1;
+    if (*s == '-') *p++ = *s++;
+
+    char digits[24];
+    int count = 0, point = -1;
+    for (; s < e; s++) {
+        if (*s == '.') {
+            if (point >= 0) return false;
+            point = count;
+        } else if (*s >= '0' && *s <= '9' && count < (int)sizeof(digits)) {
+            digits[count++] = *s;
+        } else {
+            return false;
+        }
+    }
+    if (count == 0) return false;
+    if (point < 0) point = count;
+
+    e++;
+    bool expNegative = *e == '-';
+    if (*e == '-' || *e == '+') e++;
+    if (!*e) return false;
+    int exp = 0;
+    for (; *e; e++) {
+        if (*e < '0' || *e > '9' || exp > 99) return false;
+        exp = exp * 10 + (*e - '0');
+    }
+    point += expNegative ? -exp : exp;
+
+    if (point <= 0) {
+        if (end - p < 2 - point + count) return false;
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = 0; i < -point; i++) *p++ = '0';
+        for (int i = 0; i < count; i++) *p++ = digits[i];
+    } else {
+        if (end - p < (point > count ? point : count + 1)) return false;
+        for (int i = 0; i < point; i++) *p++ = i < count ? digits[i] : '0';
+        if (count > point) {
+            *p++ = '.';
+            for (int i = point; i < count; i++) *p++ = digits[i];
+        }
+    }
+    *p = 0;
+    return true;
+}
+
+
+bool decParse(const char* s, Decimal* out, DecRound mode) {
+    const char* e = strchr(s, 'e');
+    if (e) {
+        char plain[48];
+        if (!expandExponent(s, e, plain, sizeof(plain))) return false;
+        return decParse(plain, out, mode);
+    }
+
+    bool negative = false;
+    if (*s == '-') {
+        negative = true;
+        s++;
+    }
+    uint64_t mag = 0;
+    int fracDigits = -1;  // -1 until the '.' is seen
+    uint64_t extra = 0, extraScale = 1;  // fractional digits beyond the scale
+    for (; *s; s++) {
+        if (*s == '.') {
+            if (fracDigits >= 0) return false;
+            fracDigits = 0;
+            continue;
+        }
+        if (*s < '0' || *s > '9') return false;
+        uint8_t digit = *s - '0';
+        if (fracDigits >= DEC_FRAC_DIGITS) {
+            // keep up to 18 digits of the tail, enough to round correctly
+            if (extraScale < 1000000000000000000ULL) {
+                extra = extra * 10 + digit;
+                extraScale *= 10;
+            } else if (digit) {
+                extra |= 1;  // sticky: anything non-zero further out
+            }
+            continue;
+        }
+        if (mag > ((uint64_t)INT64_MAX - digit) / 10) return false;
+        mag = mag * 10 + digit;
+        if (fracDigits >= 0) fracDigits++;
+    }
+    if (fracDigits < 0) fracDigits = 0;
+    for (int i = fracDigits; i < DEC_FRAC_DIGITS; i++) {
+        if (mag > (uint64_t)INT64_MAX / 10) return false;
+        mag *= 10;
+    }
+    int64_t raw;
+    if (!roundQuotient(mag, extra, extraScale, negative, mode, &raw)) return false;
+    out->raw = raw;
+    return true;
+}
+
+
+size_t decFormat(Decimal v, char* out, size_t size) {
+    char tmp[24];
+    char* p = tmp + sizeof(tmp);
+    *--p = 0;
+
+    uint64_t mag = magnitude(v.raw);
+    uint64_t ip = mag / DEC_SCALE;
+    uint32_t fp = (uint32_t)(mag % DEC_SCALE);
+
+    if (fp) {
+        int digits = DEC_FRAC_DIGITS;
+        while (fp % 10 == 0) {
+            fp /= 10;
+            digits--;
+        }
+        for (int i = 0; i < digits; i++) {
+            *--p = '0' + fp % 10;
+            fp /= 10;
+        }
+        *--p = '.';
+    }
+    do {
+        *--p = '0' + ip % 10;
+        ip /= 10;
+    } while (ip);
+    if (v.raw < 0) *--p = '-';
+
+    size_t len = tmp + sizeof(tmp) - 1 - p;
+    if (len + 1 > size) {
+        if (size) out[0] = 0;
+        return 0;
+    }
+    memcpy(out, p, len + 1);
+    return len;
+}
+
+
+double decToDouble(Decimal v) {
+    return (double)v.raw / (double)DEC_SCALE;
+}
+
+
+bool decFromDouble(double d, Decimal* out) {
+    double scaled = d * (double)DEC_SCALE;
+    if (!(scaled > -9.2e18 && scaled < 9.2e18)) return false;  // also rejects NaN
+    out->raw = (int64_t)(scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+    return true;
+}
@@ -0,0 +1,113 @@
+#include "energy.h"
+#include "power.h"
+#include "rtc_state.h"
+#include "esp_timer.h"
+#include <sys/time.h>
+
+static const char* const ROW_NAMES[ENERGY_ROW_COUNT] = {
+    "CPU max", "CPU usb", "CPU idle", "Display", "BLE adv", "BLE conn", "Scan", "Sleep"
+};
+
+// typical ESP32-S3 + SSD1309 figures; calibrate with "pm max" and a meter
+static const uint16_t DEFAULT_UA[ENERGY_ROW_COUNT] = {
+    45000, 20000, 8000, 12000, 3000, 5000, 500, 60
+};
+
+uint16_t energyUa[ENERGY_ROW_COUNT];
+
+// this wake's time for the rows loop() reports; the CPU rows come from power.cpp
+static uint64_t sessionUs[ENERGY_ROW_COUNT];
+static uint64_t sessionBase[ENERGY_ROW_COUNT];  // raw time at the last energyReset()
+static uint64_t lastTick = 0;
+
+
+static int64_t rtcClockUs() {
+    struct timeval tv;
+    gettimeofday(&tv, nullptr);  // kept by the RTC timer through deep sleep
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+
+void energyDefaults() {
+    memcpy(energyUa, DEFAULT_UA, sizeof(energyUa));
+}
+
+
+void energyWake() {
+    EnergyLedger& e = rtcState.energy;
+    if (e.sleptAt != 0) {
+        int64_t slept = rtcClockUs() - e.sleptAt;
+        if (slept > 0) e.ms[ENERGY_SLEEP] += slept / 1000;
+        e.sleptAt = 0;
+        rtcStateSeal();
+    }
+    lastTick = esp_timer_get_time();
+}
+
+
+void energyTick(uint8_t flags) {
+    uint64_t now = esp_timer_get_time();
+    uint64_t dt = now - lastTick;
+    lastTick = now;
+    sessionUs[ENERGY_SCAN] += dt;
+    if (flags & ENERGY_FLAG_DISPLAY) sessionUs[ENERGY_DISPLAY] += dt;
+    if (flags & ENERGY_FLAG_BLE_ADV) sessionUs[ENERGY_BLE_ADV] += dt;
+    if (flags & ENERGY_FLAG_BLE_CONN) sessionUs[ENERGY_BLE_CONN] += dt;
+}
+
+
+// On a fixed clock (no CONFIG_PM_ENABLE) the power states are only what the
+// clock would be, and the CPU draws max-clock current the whole time it's awake
+static uint64_t rawMicros(EnergyRow row) {
+    bool scaling = powerScalingActive();
+    switch (row) {
+        case ENERGY_CPU_ACTIVE: return scaling ? powerStateMicros(POWER_STATE_ACTIVE) : sessionUs[ENERGY_SCAN];
+        case ENERGY_CPU_USB:    return scaling ? powerStateMicros(POWER_STATE_USB) : 0;
+        case ENERGY_CPU_IDLE:   return scaling ? powerStateMicros(POWER_STATE_IDLE) : 0;
+        default:                return sessionUs[row];
+    }
+}
+
+
+static uint64_t sessionMicros(EnergyRow row) {
+    return rawMicros(row) - sessionBase[row];
+}
+
+
+void energySleep() {
+    EnergyLedger& e = rtcState.energy;
+    for (uint8_t r = 0; r < ENERGY_ROW_COUNT; r++) {
+        e.ms[r] += sessionMicros((EnergyRow)r) / 1000;
+    }
+    e.sleptAt = rtcClockUs();
+    rtcStateSeal();
+}
+
+
+void energyReset() {
+    memset(&rtcState.energy, 0, sizeof(rtcState.energy));
+    rtcStateSeal();
+    for (uint8_t r = 0; r < ENERGY_ROW_COUNT; r++) sessionBase[r] = rawMicros((EnergyRow)r);
+}
+
+
+const char* energyRowName(EnergyRow row) {
+    return row < ENERGY_ROW_COUNT ? ROW_NAMES[row] : "";
+}
+
+
+uint64_t energyRowMs(EnergyRow row) {
+    return rtcState.energy.ms[row] + sessionMicros(row) / 1000;
+}
+
+
+uint64_t energyRowUah(EnergyRow row) {
+    return energyRowMs(row) * energyUa[row] / 3600000;
+}
+
+
+uint64_t energyTotalUah() {
+    uint64_t total = 0;
+    for (uint8_t r = 0; r < ENERGY_ROW_COUNT; r++) total += energyRowUah((EnergyRow)r);
+    return total;
+}
@@ -0,0 +1,117 @@
+#include "expr.h"
+
+#define EXPR_STACK_MAX (EXPR_TOKEN_MAX / 2 + 1)
+
+
+static uint8_t precedence(char op) {
+    return (op == '*' || op == '/') ? 2 : 1;
+}
+
+
+void exprClear(Expr* e) {
+    e->count = 0;
+}
+
+
+bool exprPush(Expr* e, Decimal operand, char op) {
+    if (!exprHasRoom(e)) return false;
+    e->tokens[e->count++] = ExprToken{operand, 0};
+    e->tokens[e->count++] = ExprToken{{0}, op};
+    return true;
+}
+
+
+void exprSetOp(Expr* e, char op) {
+    if (exprEndsWithOp(e)) e->tokens[e->count - 1].op = op;
+}
+
+
+// false on overflow; dividing by zero gives 0, as it always has
+bool exprApply(Decimal a, char op, Decimal b, Decimal* out) {
+    switch (op) {
+        case '+': return decAdd(a, b, out);
+        case '-': return decSub(a, b, out);
+        case '*': return decMul(a, b, out);
+        case '/':
+            if (decIsZero(b)) {
+                out->raw = 0;
+                return true;
+            }
+            return decDiv(a, b, out);
+        default:
+            *out = b;
+            return true;
+    }
+}
+
+
+// pop two values and an operator, push the result
+static bool reduce(Decimal* values, uint8_t* valueCount, char* ops, uint8_t* opCount) {
+    Decimal b = values[--*valueCount];
+    Decimal a = values[*valueCount - 1];
+    return exprApply(a, ops[--*opCount], b, &values[*valueCount - 1]);
+}
+
+
+bool exprEvaluate(const Expr* e, const Decimal* last, Decimal* out) {
+    Decimal values[EXPR_STACK_MAX];
+    char ops[EXPR_STACK_MAX];
+    uint8_t valueCount = 0, opCount = 0;
+
+    uint8_t count = e->count;
+    if (!last && exprEndsWithOp(e)) count--;
+
+    for (uint8_t i = 0; i < count; i++) {
+        const ExprToken& t = e->tokens[i];
+        if (!t.op) {
+            values[valueCount++] = t.value;
+            continue;
+        }
+        // left-associative: reduce while the stacked operator binds at least as tight
+        while (opCount > 0 && precedence(ops[opCount - 1]) >= precedence(t.op)) {
+            if (!reduce(values, &valueCount, ops, &opCount)) return false;
+        }
+        ops[opCount++] = t.op;
+    }
+    if (last && exprEndsWithOp(e)) values[valueCount++] = *last;
+
+    while (opCount > 0) {
+        if (!reduce(values, &valueCount, ops, &opCount)) return false;
+    }
+    *out = valueCount ? values[0] : (last ? *last : Decimal{0});
+    return true;
+}
+
+
+size_t exprFormat(const Expr* e, char* out, size_t width) {
+    // fill from the right so the newest tokens always make it in
+    char* end = out + width;
+    char* p = end;
+    *end = 0;
+    bool cut = false;
+    for (int i = e->count - 1; i >= 0; i--) {
+        char text[24];
+        size_t len;
+        if (e->tokens[i].op) {
+            text[0] = e->tokens[i].op;
+            len = 1;
+        } else {
+            len = decFormat(e->tokens[i].value, text, sizeof(text));
+        }
+        if ((size_t)(p - out) < len) {
+            cut = true;
+            break;
+        }
+        p -= len;
+        memcpy(p, text, len);
+    }
+    if (cut) {
+        // make room for the marker by dropping whole characters
+        while (p - out < 2 && p < end) p++;
+        *--p = '.';
+        *--p = '.';
+    }
+    size_t len = end - p;
+    memmove(out, p, len + 1);
+    return len;
+}
@@ -0,0 +1,292 @@
+#include "formula.h"
+#include <Preferences.h>
+
+Formula formulas[FORMULA_MAX];
+uint8_t formulaCount = 0;
+
+// bytecode: one opcode byte, then any operand bytes
+enum FormulaOp : uint8_t {
+    OP_INT = 1,  // int16 operand, pushed as a whole number
+    OP_CONST,    // 8-byte Decimal.raw operand
+    OP_PARAM,    // 1-byte parameter index
+    OP_ADD,
+    OP_SUB,
+    OP_MUL,
+    OP_DIV,
+    OP_NEG
+};
+
+#define FORMULA_NEST_MAX 8  // parentheses / unary minus nesting in the source
+
+struct Compiler {
+    const char* s;
+    Formula* f;
+    uint8_t depth;
+    uint8_t nest;
+    const char* error;
+};
+
+static bool parseExpr(Compiler* c);
+
+
+static void skipSpaces(Compiler* c) {
+    while (*c->s == ' ') c->s++;
+}
+
+
+static bool emit(Compiler* c, const void* bytes, uint8_t n) {
+    if (c->f->codeLen + n > FORMULA_CODE_MAX) {
+        c->error = "too long";
+        return false;
+    }
+    memcpy(c->f->code + c->f->codeLen, bytes, n);
+    c->f->codeLen += n;
+    return true;
+}
+
+
+// track the evaluation stack: +1 for a push, -1 for a binary op
+static bool emitOp(Compiler* c, uint8_t op, int8_t stackDelta) {
+    if (!emit(c, &op, 1)) return false;
+    c->depth += stackDelta;
+    if (c->depth > FORMULA_STACK_MAX) {
+        c->error = "too deep";
+        return false;
+    }
+    if (c->depth > c->f->stackDepth) c->f->stackDepth = c->depth;
+    return true;
+}
+
+
+static bool parseNumber(Compiler* c) {
+    char text[24];
+    uint8_t n = 0;
+    while ((*c->s >= '0' && *c->s <= '9') || *c->s == '.') {
+        if ((size_t)n + 1 >= sizeof(text)) {
+            c->error = "bad number";
+            return false;
+        }
+        text[n++] = *c->s++;
+    }
+    text[n] = 0;
+    Decimal v;
+    if (!decParse(text, &v)) {
+        c->error = "bad number";
+        return false;
+    }
+    // small whole numbers (the 1 and 100 of most formulas) take 3 bytes, not 9
+    if (decIsInteger(v) && v.raw / DEC_SCALE >= INT16_MIN && v.raw / DEC_SCALE <= INT16_MAX) {
+        int16_t i = (int16_t)(v.raw / DEC_SCALE);
+        return emitOp(c, OP_INT, 1) && emit(c, &i, sizeof(i));
+    }
+    return emitOp(c, OP_CONST, 1) && emit(c, &v.raw, sizeof(v.raw));
+}
+
+
+// factor := number | p<digit> | '(' expr ')' | '-' factor
+static bool parseFactor(Compiler* c) {
+    skipSpaces(c);
+    char ch = *c->s;
+    if ((ch >= '0' && ch <= '9') || ch == '.') return parseNumber(c);
+    if (ch == 'p' || ch == 'P') {
+        c->s++;
+        uint8_t index = *c->s - '0';
+        if (index >= FORMULA_PARAM_MAX) {
+            c->error = "params are p0..p3";
+            return false;
+        }
+        c->s++;
+        if (index + 1 > c->f->paramCount) c->f->paramCount = index + 1;
+        return emitOp(c, OP_PARAM, 1) && emit(c, &index, 1);
+    }
+    if (ch == '(' || ch == '-') {
+        if (++c->nest > FORMULA_NEST_MAX) {
+            c->error = "too deep";
+            return false;
+        }
+        c->s++;
+        bool ok;
+        if (ch == '(') {
+            ok = parseExpr(c);
+            skipSpaces(c);
+            if (ok && *c->s != ')') {
+                c->error = "missing )";
+                ok = false;
+            }
+            if (ok) c->s++;
+        } else {
+            ok = parseFactor(c) && emitOp(c, OP_NEG, 0);
+        }
+        c->nest--;
+        return ok;
+    }
+    c->error = ch ? "unexpected character" : "unexpected end";
+    return false;
+}
+
+
+// term := factor (('*' | '/') factor)*
+static bool parseTerm(Compiler* c) {
+    if (!parseFactor(c)) return false;
+    for (;;) {
+        skipSpaces(c);
+        char op = *c->s;
+        if (op != '*' && op != '/') return true;
+        c->s++;
+        if (!parseFactor(c) || !emitOp(c, op == '*' ? OP_MUL : OP_DIV, -1)) return false;
+    }
+}
+
+
+// expr := term (('+' | '-') term)*
+static bool parseExpr(Compiler* c) {
+    if (!parseTerm(c)) return false;
+    for (;;) {
+        skipSpaces(c);
+        char op = *c->s;
+        if (op != '+' && op != '-') return true;
+        c->s++;
+        if (!parseTerm(c) || !emitOp(c, op == '+' ? OP_ADD : OP_SUB, -1)) return false;
+    }
+}
+
+
+const char* formulaCompile(const char* text, Formula* out) {
+    out->paramCount = 0;
+    out->stackDepth = 0;
+    out->codeLen = 0;
+    Compiler c = {text, out, 0, 0, nullptr};
+    if (!parseExpr(&c)) return c.error;
+    skipSpaces(&c);
+    if (*c.s) return "unexpected character";
+    if (out->paramCount == 0) return "no parameters";
+    return nullptr;
+}
+
+
+bool formulaRun(const Formula* f, const Decimal* params, Decimal* out) {
+    Decimal stack[FORMULA_STACK_MAX];
+    uint8_t sp = 0;
+    const uint8_t* pc = f->code;
+    const uint8_t* end = f->code + (f->codeLen <= FORMULA_CODE_MAX ? f->codeLen : 0);
+
+    // bounds are checked as we go, so a corrupt blob from NVS fails cleanly
+    while (pc < end) {
+        uint8_t op = *pc++;
+        if (op <= OP_PARAM) {
+            if (sp >= FORMULA_STACK_MAX) return false;
+            if (op == OP_INT) {
+                int16_t i;
+                if (end - pc < (int)sizeof(i)) return false;
+                memcpy(&i, pc, sizeof(i));
+                pc += sizeof(i);
+                stack[sp++] = decFromInt(i);
+            } else if (op == OP_CONST) {
+                if (end - pc < (int)sizeof(int64_t)) return false;
+                memcpy(&stack[sp].raw, pc, sizeof(int64_t));
+                pc += sizeof(int64_t);
+                // decParse never yields it; only a corrupt or crafted blob does
+                if (stack[sp++].raw == INT64_MIN) return false;
+            } else if (op == OP_PARAM) {
+                if (pc >= end || *pc >= f->paramCount) return false;
+                stack[sp++] = params[*pc++];
+            } else {
+                return false;
+            }
+            continue;
+        }
+        if (op == OP_NEG) {
+            if (sp < 1 || stack[sp - 1].raw == INT64_MIN) return false;  // -INT64_MIN overflows
+            stack[sp - 1].raw = -stack[sp - 1].raw;
+            continue;
+        }
+        if (sp < 2) return false;
+        Decimal b = stack[--sp];
+        Decimal* a = &stack[sp - 1];
+        bool ok;
+        switch (op) {
+            case OP_ADD: ok = decAdd(*a, b, a); break;
+            case OP_SUB: ok = decSub(*a, b, a); break;
+            case OP_MUL: ok = decMul(*a, b, a); break;
+            case OP_DIV: ok = decDiv(*a, b, a); break;
+            default:     ok = false; break;
+        }
+        if (!ok) return false;
+    }
+    if (sp != 1) return false;
+    *out = stack[0];
+    return true;
+}
+
+
+static void slotKey(char* key, uint8_t slot) {
+    strcpy(key, "fml0");
+    key[3] = '0' + slot;
+}
+
+
+void formulaLoadAll() {
+    Preferences prefs;
+    prefs.begin("t2", true);
+    formulaCount = 0;
+    for (uint8_t slot = 0; slot < FORMULA_MAX; slot++) {
+        char key[6];
+        slotKey(key, slot);
+        Formula& f = formulas[formulaCount];
+        if (prefs.getBytes(key, &f, sizeof(f)) != sizeof(f)) continue;
+        f.name[FORMULA_NAME_MAX] = 0;
+        if (!f.name[0] || f.codeLen > FORMULA_CODE_MAX
+            || f.paramCount == 0 || f.paramCount > FORMULA_PARAM_MAX) continue;
+        formulaCount++;
+    }
+    prefs.end();
+}
+
+
+void formulaSaveAll() {
+    Preferences prefs;
+    prefs.begin("t2", false);
+    for (uint8_t slot = 0; slot < FORMULA_MAX; slot++) {
+        char key[6];
+        slotKey(key, slot);
+        if (slot < formulaCount) {
+            prefs.putBytes(key, &formulas[slot], sizeof(Formula));
+        } else if (prefs.isKey(key)) {
+            prefs.remove(key);
+        }
+    }
+    prefs.end();
+}
+
+
+void formulaClearAll() {
+    formulaCount = 0;
+}
+
+
+int formulaFind(const char* name) {
+    for (uint8_t i = 0; i < formulaCount; i++) {
+        if (strcmp(formulas[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+
+bool formulaStore(const Formula* f) {
+    int i = formulaFind(f->name);
+    if (i < 0) {
+        if (formulaCount >= FORMULA_MAX) return false;
+        i = formulaCount++;
+    }
+    formulas[i] = *f;
+    return true;
+}
+
+
+int formulaRemove(const char* name) {
+    int i = formulaFind(name);
+    if (i < 0) return -1;
+    for (uint8_t j = i; j + 1 < formulaCount; j++) formulas[j] = formulas[j + 1];
+    formulaCount--;
+    return i;
+}
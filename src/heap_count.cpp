@@ -0,0 +1,30 @@
+#include "heap_count.h"
+
+#ifdef PERF_LOG
+
+volatile uint32_t heapAllocCount = 0;
+
+extern "C" {
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    heapAllocCount++;
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+    heapAllocCount++;
+    return __real_calloc(count, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    heapAllocCount++;
+    return __real_realloc(ptr, size);
+}
+
+}
+
+#endif
@@ -1,11 +1,32 @@
 #include "hid.h"
 #include "hid_usb.h"
 #include "hid_ble.h"
+#include "power.h"
+#include "tasks.h"
+#include "freertos/queue.h"
 
 extern bool bleConnected;  // defined in main.cpp
 
 bool hidInitialized = false;
 
+#define HID_QUEUE_SIZE 256  // jobs, one per key or character
+
+enum HidJobKind : uint8_t {
+    HID_JOB_KEY,   // numpad key
+    HID_JOB_TEXT,  // character of a paced hidSendString()
+    HID_JOB_TYPE   // character queued by hidQueueString()
+};
+
+struct HidJob {
+    uint8_t kind;
+    char key;
+    bool numLockOn;
+};
+
+// a job stays queued while it runs (peeked, then received once sent), so the
+// queue is empty only when everything posted has reached the host
+static QueueHandle_t jobs = nullptr;
+
 
 void hidInit() {
     if (hidInitialized) return;
@@ -14,26 +35,98 @@ void hidInit() {
 }
 
 
-void hidSendNumpadKey(char key, bool numLockOn) {
-    if (!hidInitialized) return;
-    if (bleConnected && hidBleIsConnected()) {
-        hidBleSendNumpadKey(key, numLockOn);
-    } else {
-        hidUsbSendNumpadKey(key, numLockOn);
+static bool useBle() {
+    return bleConnected && hidBleIsConnected();
+}
+
+
+static void runJob(const HidJob& job) {
+    switch (job.kind) {
+        case HID_JOB_KEY:
+            if (useBle()) hidBleSendNumpadKey(job.key, job.numLockOn);
+            else hidUsbSendNumpadKey(job.key, job.numLockOn);
+            break;
+        case HID_JOB_TEXT: {
+            char s[2] = {job.key, 0};
+            if (useBle()) hidBleSendString(s);
+            else hidUsbSendString(s);
+            break;
+        }
+        case HID_JOB_TYPE:
+            if (useBle()) hidBleTypeChar(job.key);
+            else hidUsbTypeChar(job.key);
+            break;
     }
 }
 
 
-void hidSendString(const String& str) {
-    if (!hidInitialized) return;
-    if (bleConnected && hidBleIsConnected()) {
-        hidBleSendString(str);
-    } else {
-        hidUsbSendString(str);
+static void hidTask(void* arg) {
+    (void)arg;
+    HidJob job;
+    for (;;) {
+        xQueuePeek(jobs, &job, portMAX_DELAY);
+        taskBusyBegin(TASK_HID);
+        powerBoost(POWER_HID);
+        // a queued run keeps the clock up until it's all typed
+        do {
+            runJob(job);
+            xQueueReceive(jobs, &job, 0);
+        } while (xQueuePeek(jobs, &job, 0) == pdTRUE);
+        powerRelax(POWER_HID);
+        taskBusyEnd(TASK_HID);
     }
 }
 
 
+void hidBegin() {
+    if (jobs) return;
+    jobs = xQueueCreate(HID_QUEUE_SIZE, sizeof(HidJob));
+    taskStart(TASK_HID, hidTask);
+}
+
+
+static void post(uint8_t kind, char key, bool numLockOn, TickType_t wait) {
+    HidJob job = {kind, key, numLockOn};
+    xQueueSend(jobs, &job, wait);
+}
+
+
+void hidSendNumpadKey(char key, bool numLockOn) {
+    if (!hidInitialized || !jobs) return;
+    post(HID_JOB_KEY, key, numLockOn, portMAX_DELAY);
+}
+
+
+void hidSendString(const char* str) {
+    if (!hidInitialized || !jobs) return;
+    for (const char* p = str; *p; p++) post(HID_JOB_TEXT, *p, true, portMAX_DELAY);
+}
+
+
+bool hidUsbMounted() {
+    return hidInitialized && hidUsbIsMounted();
+}
+
+
 void hidSendKey(char key, bool numLockOn) {
     hidSendNumpadKey(key, numLockOn);
 }
+
+
+bool hidQueueString(const char* str) {
+    size_t len = strlen(str);
+    // the UI task is the only producer, so the room can only grow meanwhile
+    if (!jobs || len > uxQueueSpacesAvailable(jobs)) return false;
+    for (size_t i = 0; i < len; i++) post(HID_JOB_TYPE, str[i], true, 0);
+    return true;
+}
+
+
+bool hidBusy() {
+    return jobs && uxQueueMessagesWaiting(jobs) > 0;
+}
+
+
+void hidFlush() {
+    while (hidBusy()) vTaskDelay(1);
+}
@@ -3,6 +3,7 @@
 #include <BLEDevice.h>
 #include <BLEAdvertising.h>
 #include "esp_gap_ble_api.h"
+#include "freertos/semphr.h"
 
 extern uint8_t zoomModifier;  // defined in main.cpp: 0 = Ctrl, 1 = Cmd/GUI
 
@@ -47,7 +48,16 @@ uint8_t PeerAwareBleKeyboard::s_peerMac[6] = {0};
 bool PeerAwareBleKeyboard::s_peerKnown = false;
 
 static PeerAwareBleKeyboard* bleKb = nullptr;
-static bool bleActive = false;
+static volatile bool bleActive = false;
+
+// init/deinit run on the UI task, sends on the HID task and the link check on
+// the BLE task; the lock keeps the keyboard from being ended under a send
+static SemaphoreHandle_t bleLock = xSemaphoreCreateMutex();
+
+struct BleLock {
+    BleLock() { xSemaphoreTake(bleLock, portMAX_DELAY); }
+    ~BleLock() { xSemaphoreGive(bleLock); }
+};
 
 
 static void ensureKb() {
@@ -58,6 +68,7 @@ static void ensureKb() {
 
 
 void hidBleInit(bool pairingMode) {
+    BleLock lock;
     if (bleActive) return;
     ensureKb();
     bleKb->begin();
@@ -125,9 +136,10 @@ void hidBleInit(bool pairingMode) {
 
 
 void hidBleDeinit() {
+    BleLock lock;
     if (!bleActive) return;
-    if (bleKb) bleKb->end();
     bleActive = false;
+    if (bleKb) bleKb->end();
 }
 
 
@@ -137,6 +149,7 @@ bool hidBleIsActive() {
 
 
 bool hidBleIsConnected() {
+    BleLock lock;
     if (!bleActive || !bleKb) return false;
     return bleKb->isConnected();
 }
@@ -200,6 +213,7 @@ bool hidBleDeleteBond(uint8_t index) {
 
 
 void hidBleSendNumpadKey(char key, bool numLockOn) {
+    BleLock lock;
     if (!bleActive || !bleKb || !bleKb->isConnected()) return;
 
     uint8_t code = 0;
@@ -275,17 +289,28 @@ void hidBleSendNumpadKey(char key, bool numLockOn) {
 }
 
 
-void hidBleSendString(const String& str) {
+void hidBleSendString(const char* str) {
+    BleLock lock;
     if (!bleActive || !bleKb || !bleKb->isConnected()) return;
-    for (size_t i = 0; i < str.length(); i++) {
-        bleKb->write((uint8_t)str.charAt(i));
+    for (const char* p = str; *p; p++) {
+        bleKb->write((uint8_t)*p);
         bleKb->releaseAll();
         delay(10);
     }
 }
 
 
+void hidBleTypeChar(char c) {
+    BleLock lock;
+    if (!bleActive || !bleKb || !bleKb->isConnected()) return;
+    bleKb->write((uint8_t)c);
+    bleKb->releaseAll();
+    delay(10);  // same pacing as hidBleSendString
+}
+
+
 void hidBleClearReport() {
+    BleLock lock;
     if (bleActive && bleKb && bleKb->isConnected()) {
         bleKb->releaseAll();
     }
@@ -293,6 +318,7 @@ void hidBleClearReport() {
 
 
 void hidBleApplyFastConnParams() {
+    BleLock lock;
     if (!bleActive || !bleKb || !bleKb->isConnected()) return;
     if (!PeerAwareBleKeyboard::s_peerKnown) return;
     // Re-request the fast HID interval after the link has settled. Windows
@@ -309,6 +335,7 @@ void hidBleApplyFastConnParams() {
 
 
 const uint8_t* hidBleGetPeerMac() {
+    BleLock lock;
     if (!bleActive || !bleKb || !bleKb->isConnected()) return nullptr;
     if (!PeerAwareBleKeyboard::s_peerKnown) return nullptr;
     return PeerAwareBleKeyboard::s_peerMac;
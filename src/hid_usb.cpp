@@ -6,6 +6,9 @@ extern uint8_t zoomModifier;  // defined in main.cpp: 0 = Ctrl, 1 = Cmd/GUI
 
 static USBHIDKeyboard Keyboard;
 static bool usbStarted = false;
+static uint32_t usbReadyAt = 0;  // host needs ~1.5s to re-enumerate with the HID interface
+
+#define USB_ENUMERATE_MS 1500
 
 // raw USB HID usage codes (page 0x07) for the keypad block
 #define KEY_NUMPAD_DIV   0x54
@@ -62,12 +65,24 @@ void hidUsbInit() {
     Keyboard.begin();
     USB.begin();
     usbStarted = true;
-    delay(1500); // wait for host to re-enumerate with the HID interface
+    // don't block here: boot starts USB in the background, and only a send
+    // that arrives before the host has re-enumerated needs to wait
+    usbReadyAt = millis() + USB_ENUMERATE_MS;
+}
+
+
+// wait out whatever is left of the enumeration window (no-op once it's over)
+static void usbWaitReady() {
+    if (usbReadyAt == 0) return;
+    int32_t left = (int32_t)(usbReadyAt - millis());
+    if (left > 0) delay(left);
+    usbReadyAt = 0;
 }
 
 
 void hidUsbSendNumpadKey(char key, bool numLockOn) {
     if (!usbStarted) return;
+    usbWaitReady();
 
     uint8_t keycode = 0;
 
@@ -149,12 +164,26 @@ void hidUsbSendNumpadKey(char key, bool numLockOn) {
 }
 
 
-void hidUsbSendString(const String& str) {
+void hidUsbSendString(const char* str) {
     if (!usbStarted) return;
-    for (int i = 0; i < str.length(); i++) {
-        char c = str.charAt(i);
-        Keyboard.print(c);
+    usbWaitReady();
+    for (const char* p = str; *p; p++) {
+        Keyboard.print(*p);
         Keyboard.releaseAll();
         delay(10);
     }
 }
+
+
+bool hidUsbIsMounted() {
+    return usbStarted && USB;
+}
+
+
+void hidUsbTypeChar(char c) {
+    if (!usbStarted) return;
+    usbWaitReady();
+    Keyboard.write((uint8_t)c);  // maps '\t' and '\n' to Tab and Enter
+    Keyboard.releaseAll();
+    delay(10);  // same pacing as hidUsbSendString; hosts drop back-to-back reports
+}
@@ -1,26 +1,189 @@
 #include "macros.h"
+#include "formula.h"
+#include "tvm.h"
+#include "stats.h"
 
-MacroContext macro = {MACRO_IDLE, "", {0}, 0, 0, 0};
+MacroContext macro = {MACRO_IDLE, 0, {}, 0, 0, {0}, false};
 
-const char* MACRO_NAMES[] = {
-    "TAX+",
-    "TAX-",
-    "PCT",
-    "MRKUP",
-    "DISC",
-    "CMPND"
-};
-const uint8_t MACRO_COUNT = 6;
 uint8_t menuIndex = 0;
 
-const char* PROMPTS_TAX_ADD[] = {"Amount?", "Tax %?"};
-const char* PROMPTS_TAX_SUB[] = {"Total?", "Tax %?"};
-const char* PROMPTS_PERCENT[] = {"Amount?", "Percent?"};
-const char* PROMPTS_MARKUP[] = {"Cost?", "Markup %?"};
-const char* PROMPTS_DISCOUNT[] = {"Price?", "Discount %?"};
-const char* PROMPTS_COMPOUND[] = {"Principal?", "Rate %?", "Periods?"};
+const char* const PROMPTS_TAX_ADD[] = {"Amount?", "Tax %?"};
+const char* const PROMPTS_TAX_SUB[] = {"Total?", "Tax %?"};
+const char* const PROMPTS_PERCENT[] = {"Amount?", "Percent?"};
+const char* const PROMPTS_MARKUP[] = {"Cost?", "Markup %?"};
+const char* const PROMPTS_DISCOUNT[] = {"Price?", "Discount %?"};
+const char* const PROMPTS_COMPOUND[] = {"Principal?", "Rate %?", "Periods?"};
+const char* const PROMPTS_FORMULA[] = {"p0?", "p1?", "p2?", "p3?"};
+const char* const PROMPTS_TVM_PMT[] = {"Periods N?", "Rate % I/Y?", "PV?", "FV?"};
+const char* const PROMPTS_TVM_N[] = {"Rate % I/Y?", "PV?", "PMT?", "FV?"};
+const char* const PROMPTS_TVM_RATE[] = {"Periods N?", "PV?", "PMT?", "FV?"};
+const char* const PROMPTS_TVM_PV[] = {"Periods N?", "Rate % I/Y?", "PMT?", "FV?"};
+const char* const PROMPTS_TVM_FV[] = {"Periods N?", "Rate % I/Y?", "PV?", "PMT?"};
+const char* const PROMPTS_IRR[] = {"CF0 (outlay)?", "CF1?", "CF2?", "CF3?"};
+const char* const PROMPTS_STATS[] = {"Value?"};
+
+static const Decimal DEC_HUNDRED = {100 * DEC_SCALE};
+#define COMPOUND_STEP_MAX 1200  // whole periods compounded exactly; beyond that, pow()
+
+
+// principal * (1 + rate/100)^periods. Whole periods compound one decimal
+// multiply at a time (one rounding per period, like a bank statement);
+// fractional or very long runs fall back to pow().
+static bool compound(Decimal principal, Decimal rate, Decimal periods, Decimal* out) {
+    Decimal growth;
+    if (!decAdd(DEC_HUNDRED, rate, &growth)) return false;
+    if (decIsInteger(periods) && periods.raw >= 0
+        && periods.raw <= (int64_t)COMPOUND_STEP_MAX * DEC_SCALE) {
+        Decimal value = principal;
+        for (int64_t n = periods.raw / DEC_SCALE; n > 0; n--) {
+            if (!decMulDiv(value, growth, DEC_HUNDRED, &value)) return false;
+        }
+        *out = value;
+        return true;
+    }
+    double g = decToDouble(growth) / 100;
+    return decFromDouble(decToDouble(principal) * pow(g, decToDouble(periods)), out);
+}
+
+
+// amount + amount * pct / 100 (tax added, markup)
+static bool addPercent(const Decimal* p, Decimal* out) {
+    Decimal part;
+    return decMulDiv(p[0], p[1], DEC_HUNDRED, &part) && decAdd(p[0], part, out);
+}
+
+
+// amount - amount * pct / 100 (discount)
+static bool subPercent(const Decimal* p, Decimal* out) {
+    Decimal part;
+    return decMulDiv(p[0], p[1], DEC_HUNDRED, &part) && decSub(p[0], part, out);
+}
+
+
+// total * 100 / (100 + tax)
+static bool taxSub(const Decimal* p, Decimal* out) {
+    Decimal base;
+    return decAdd(DEC_HUNDRED, p[1], &base) && decMulDiv(p[0], DEC_HUNDRED, base, out);
+}
+
+
+static bool percent(const Decimal* p, Decimal* out) {
+    return decMulDiv(p[0], p[1], DEC_HUNDRED, out);
+}
+
+
+static bool compoundMacro(const Decimal* p, Decimal* out) {
+    return compound(p[0], p[1], p[2], out);
+}
+
+
+// TVM (tvm.h) works in doubles: the rate solvers need pow/log anyway, and the
+// answers are rounded back into a Decimal once. Rates go in and out in percent.
+static double dbl(Decimal v) {
+    return decToDouble(v);
+}
 
-const char** currentPrompts = nullptr;
+
+static bool tvmPmtMacro(const Decimal* p, Decimal* out) {
+    double r;
+    return tvmPmt(dbl(p[0]), dbl(p[1]) / 100, dbl(p[2]), dbl(p[3]), &r) && decFromDouble(r, out);
+}
+
+
+static bool tvmNMacro(const Decimal* p, Decimal* out) {
+    double r;
+    return tvmN(dbl(p[0]) / 100, dbl(p[1]), dbl(p[2]), dbl(p[3]), &r) && decFromDouble(r, out);
+}
+
+
+static bool tvmRateMacro(const Decimal* p, Decimal* out) {
+    double r;
+    return tvmRate(dbl(p[0]), dbl(p[1]), dbl(p[2]), dbl(p[3]), &r) && decFromDouble(r * 100, out);
+}
+
+
+static bool tvmPvMacro(const Decimal* p, Decimal* out) {
+    double r;
+    return tvmPv(dbl(p[0]), dbl(p[1]) / 100, dbl(p[2]), dbl(p[3]), &r) && decFromDouble(r, out);
+}
+
+
+static bool tvmFvMacro(const Decimal* p, Decimal* out) {
+    double r;
+    return tvmFv(dbl(p[0]), dbl(p[1]) / 100, dbl(p[2]), dbl(p[3]), &r) && decFromDouble(r, out);
+}
+
+
+// up to four flows; trailing zeros are dropped, so two or three flows work too
+static bool irrMacro(const Decimal* p, Decimal* out) {
+    double flows[4];
+    uint8_t count = 0;
+    for (uint8_t k = 0; k < 4; k++) {
+        flows[k] = dbl(p[k]);
+        if (flows[k] != 0) count = k + 1;
+    }
+    double r;
+    return tvmIrr(flows, count, &r) && decFromDouble(r * 100, out);
+}
+
+
+// stats mode: fold each entry into the running column, O(1) per key
+static bool statsMacro(const Decimal* p, Decimal* out) {
+    statsAdd(p[0]);
+    *out = p[0];
+    return true;
+}
+
+
+#define PROMPT_COUNT(prompts) (sizeof(prompts) / sizeof(prompts[0]))
+
+// adding a macro is one line here; order is menu order
+constexpr MacroDef MACROS[] = {
+    {"TAX+",  PROMPTS_TAX_ADD,  PROMPT_COUNT(PROMPTS_TAX_ADD),  addPercent},
+    {"TAX-",  PROMPTS_TAX_SUB,  PROMPT_COUNT(PROMPTS_TAX_SUB),  taxSub},
+    {"PCT",   PROMPTS_PERCENT,  PROMPT_COUNT(PROMPTS_PERCENT),  percent},
+    {"MRKUP", PROMPTS_MARKUP,   PROMPT_COUNT(PROMPTS_MARKUP),   addPercent},
+    {"DISC",  PROMPTS_DISCOUNT, PROMPT_COUNT(PROMPTS_DISCOUNT), subPercent},
+    {"CMPND", PROMPTS_COMPOUND, PROMPT_COUNT(PROMPTS_COMPOUND), compoundMacro},
+    {"PMT",   PROMPTS_TVM_PMT,  PROMPT_COUNT(PROMPTS_TVM_PMT),  tvmPmtMacro},
+    {"N",     PROMPTS_TVM_N,    PROMPT_COUNT(PROMPTS_TVM_N),    tvmNMacro},
+    {"I/Y",   PROMPTS_TVM_RATE, PROMPT_COUNT(PROMPTS_TVM_RATE), tvmRateMacro},
+    {"PV",    PROMPTS_TVM_PV,   PROMPT_COUNT(PROMPTS_TVM_PV),   tvmPvMacro},
+    {"FV",    PROMPTS_TVM_FV,   PROMPT_COUNT(PROMPTS_TVM_FV),   tvmFvMacro},
+    {"IRR",   PROMPTS_IRR,      PROMPT_COUNT(PROMPTS_IRR),      irrMacro},
+    {"STATS", PROMPTS_STATS,    PROMPT_COUNT(PROMPTS_STATS),    statsMacro, true},
+};
+const uint8_t MACRO_COUNT = sizeof(MACROS) / sizeof(MACROS[0]);
+
+
+static_assert(sizeof(MACROS) / sizeof(MACROS[0]) < MACRO_REF_FORMULA, "built-ins overlap formula refs");
+
+
+uint8_t macroCount() {
+    return MACRO_COUNT + formulaCount;
+}
+
+
+int8_t macroRef(uint8_t index) {
+    if (index >= macroCount()) return MACRO_REF_NONE;
+    return index < MACRO_COUNT ? index : MACRO_REF_FORMULA + (index - MACRO_COUNT);
+}
+
+
+int macroFromRef(int8_t ref) {
+    if (ref >= MACRO_REF_FORMULA) {
+        uint8_t slot = ref - MACRO_REF_FORMULA;
+        return slot < formulaCount ? MACRO_COUNT + slot : -1;
+    }
+    return ref >= 0 && ref < MACRO_COUNT ? ref : -1;
+}
+
+
+const char* macroName(uint8_t index) {
+    if (index < MACRO_COUNT) return MACROS[index].name;
+    if (index < macroCount()) return formulas[index - MACRO_COUNT].name;
+    return "";
+}
 
 
 void macroMenuOpen() {
@@ -30,81 +193,68 @@ void macroMenuOpen() {
 
 void macroMenuUp() {
     if (menuIndex > 0) menuIndex--;
-    else menuIndex = MACRO_COUNT - 1;  // wrap
+    else menuIndex = macroCount() - 1;  // wrap
 }
 
 
 void macroMenuDown() {
-    if (menuIndex < MACRO_COUNT - 1) menuIndex++;
+    if (menuIndex < macroCount() - 1) menuIndex++;
     else menuIndex = 0;  // wrap
 }
 
 
 void macroMenuSelect() {
     if (macro.state == MACRO_MENU) {
-        macroStart(MACRO_NAMES[menuIndex]);
+        macroStart(menuIndex);
     }
 }
 
 
-void macroStart(const char* name) {
-    macro.functionName = name;
+void macroStart(uint8_t index) {
+    if (index >= macroCount()) return;
+    macro.index = index;
     macro.paramIndex = 0;
-    macro.result = 0;
+    macro.paramCount = index < MACRO_COUNT ? MACROS[index].paramCount
+                                           : formulas[index - MACRO_COUNT].paramCount;
+    macro.result.raw = 0;
+    macro.failed = false;
+    macro.batch = false;
+    macro.batchPinned = false;
+    macro.batchCount = 0;
+    macro.stream = index < MACRO_COUNT && MACROS[index].stream;
     macro.state = MACRO_AWAITING_INPUT;
-    
-    if (strcmp(name, "TAX+") == 0) {
-        macro.paramCount = 2;
-        currentPrompts = PROMPTS_TAX_ADD;
-    }
-    else if (strcmp(name, "TAX-") == 0) {
-        macro.paramCount = 2;
-        currentPrompts = PROMPTS_TAX_SUB;
-    }
-    else if (strcmp(name, "PCT") == 0) {
-        macro.paramCount = 2;
-        currentPrompts = PROMPTS_PERCENT;
-    }
-    else if (strcmp(name, "MRKUP") == 0) {
-        macro.paramCount = 2;
-        currentPrompts = PROMPTS_MARKUP;
-    }
-    else if (strcmp(name, "DISC") == 0) {
-        macro.paramCount = 2;
-        currentPrompts = PROMPTS_DISCOUNT;
-    }
-    else if (strcmp(name, "CMPND") == 0) {
-        macro.paramCount = 3;
-        currentPrompts = PROMPTS_COMPOUND;
-    }
 }
 
 
-bool macroInput(double value) {
+void macroStartBatch(uint8_t index) {
+    macroStart(index);
+    macro.batch = !macro.stream;  // a stream macro's results are just its inputs
+}
+
+
+bool macroInput(Decimal value) {
     if (macro.state != MACRO_AWAITING_INPUT) return false;
     
     macro.params[macro.paramIndex++] = value;
     
-    if (macro.paramIndex >= macro.paramCount) {
-        if (macro.functionName == "TAX+") {
-            macro.result = macro.params[0] * (1 + macro.params[1] / 100);
-        }
-        else if (macro.functionName == "TAX-") {
-            macro.result = macro.params[0] / (1 + macro.params[1] / 100);
-        }
-        else if (macro.functionName == "PCT") {
-            macro.result = macro.params[0] * (macro.params[1] / 100);
-        }
-        else if (macro.functionName == "MRKUP") {
-            macro.result = macro.params[0] * (1 + macro.params[1] / 100);
-        }
-        else if (macro.functionName == "DISC") {
-            macro.result = macro.params[0] * (1 - macro.params[1] / 100);
+    if (macro.paramIndex >= macro.paramCount || macro.batchPinned) {
+        bool ok = macro.index < MACRO_COUNT
+            ? MACROS[macro.index].compute(macro.params, &macro.result)
+            : formulaRun(&formulas[macro.index - MACRO_COUNT], macro.params, &macro.result);
+        if (!ok) macro.result.raw = 0;
+        macro.failed = !ok;
+        
+        if (macro.stream) {
+            macro.paramIndex = 0;
+            return true;
         }
-        else if (macro.functionName == "CMPND") {
-            macro.result = macro.params[0] * pow(1 + macro.params[1] / 100, macro.params[2]);
+        if (macro.batch) {
+            // first run collects every param; later ones only replace the amount
+            macro.batchPinned = true;
+            macro.batchCount++;
+            macro.paramIndex = 0;
+            return true;
         }
-        
         macro.state = MACRO_COMPLETE;
         return true;
     }
@@ -115,15 +265,12 @@ bool macroInput(double value) {
 
 void macroCancel() {
     macro.state = MACRO_IDLE;
-    macro.functionName = "";
     macro.paramIndex = 0;
-    currentPrompts = nullptr;
 }
 
 
 const char* macroGetPrompt() {
-    if (macro.state != MACRO_AWAITING_INPUT || currentPrompts == nullptr) {
-        return "";
-    }
-    return currentPrompts[macro.paramIndex];
+    if (macro.state != MACRO_AWAITING_INPUT) return "";
+    if (macro.index >= MACRO_COUNT) return PROMPTS_FORMULA[macro.paramIndex];
+    return MACROS[macro.index].prompts[macro.paramIndex];
 }
\ No newline at end of file
@@ -22,10 +22,13 @@ static const char* GUIDE_BASIC[] = {
     "Numbers and + - * /",
     "work like a normal",
     "calculator. [Enter]",
-    "computes the result.",
+    "computes the result;",
+    "* and / go before",
+    "+ and -, and the top",
+    "line shows the sum.",
     "[NUM] clears in",
     "steps: current entry,",
-    "then pending op,",
+    "then the expression,",
     "then macro name.",
 };
 static const char* GUIDE_MACRO_MENU[] = {
@@ -34,10 +37,20 @@ static const char* GUIDE_MACRO_MENU[] = {
     "and release to open",
     "the macro menu.",
     "[4]/[6] page between",
-    "Macros and Settings.",
+    "Macros, Settings,",
+    "History (last 16",
+    "results, [5] reuses)",
+    "and Tape (everything",
+    "keyed since wake).",
     "In the menu:",
     "[8]/[2] scroll",
     "[5]/[Enter] select",
+    "[.] batch: after the",
+    "first run, each new",
+    "amount + [Enter] is",
+    "typed to the host,",
+    "then Tab or Enter",
+    "(Settings).",
     "[NUM] cancel",
 };
 static const char* GUIDE_NUMPAD[] = {
@@ -73,6 +86,34 @@ static const char* GUIDE_SEND[] = {
     "Handy for pasting",
     "results into forms.",
 };
+static const char* GUIDE_MEMORY[] = {
+    "MEMORY",
+    "Hold [-] and tap:",
+    "[+] M+ adds display",
+    "[.] M- subtracts it",
+    "[NUM] MR recalls;",
+    "tap again to clear.",
+    "An M shows at the",
+    "bottom while memory",
+    "is in use. It is kept",
+    "through sleep.",
+};
+static const char* GUIDE_STATS[] = {
+    "STATS MODE",
+    "Pick STATS in the",
+    "macro menu, then key",
+    "each value + [Enter].",
+    "The top line shows",
+    "a running stat:",
+    "[/] next stat (N,",
+    "SUM, MEAN, SD, MIN,",
+    "MAX, SLOPE, ICPT,",
+    "MED, P90)",
+    "[*] recalls it.",
+    "[/] to CLEAR, then",
+    "[*] starts a new",
+    "column.",
+};
 static const char* GUIDE_SLEEP[] = {
     "AUTO SLEEP",
     "Device sleeps after",
@@ -92,6 +133,8 @@ const GuidePage GUIDE_PAGES[] = {
     {GUIDE_MACRO_MENU, sizeof(GUIDE_MACRO_MENU) / sizeof(GUIDE_MACRO_MENU[0])},
     {GUIDE_NUMPAD,     sizeof(GUIDE_NUMPAD)     / sizeof(GUIDE_NUMPAD[0])},
     {GUIDE_SEND,       sizeof(GUIDE_SEND)       / sizeof(GUIDE_SEND[0])},
+    {GUIDE_MEMORY,     sizeof(GUIDE_MEMORY)     / sizeof(GUIDE_MEMORY[0])},
+    {GUIDE_STATS,      sizeof(GUIDE_STATS)      / sizeof(GUIDE_STATS[0])},
     {GUIDE_SLEEP,      sizeof(GUIDE_SLEEP)      / sizeof(GUIDE_SLEEP[0])},
     {GUIDE_DONE,       sizeof(GUIDE_DONE)       / sizeof(GUIDE_DONE[0])},
 };
@@ -111,26 +154,49 @@ enum GuideAction {
 #include <Preferences.h>
 #include "icons.h"
 #include "macros.h"
+#include "formula.h"
 #include "hid.h"
 #include "hid_ble.h"
+#include "perf.h"
+#include "console.h"
+#include "fixed_string.h"
+#include "decimal.h"
+#include "numfmt.h"
+#include "expr.h"
+#include "rtc_state.h"
+#include "esp_rom_crc.h"
+#include "tvm.h"
+#include "stats.h"
+#include "tape.h"
+#include "battery.h"
+#include "power.h"
+#include "energy.h"
+#include "timers.h"
+#include "tasks.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "heap_count.h"
 #include "driver/rtc_io.h"
+#include "driver/gpio.h"
+#include "hal/gpio_ll.h"
+#include "esp_timer.h"
 
 #define SDA_PIN 5
 #define LED_PIN 21
 #define SCL_PIN 6
 #define WAKE_PIN 1 // Enter key
 #define DEFAULT_SLEEP_TIMEOUT 300000
+#define SLEEP_TIMEOUT_MIN_MS 60000UL          // the settings menu takes 1..9999 minutes
+#define SLEEP_TIMEOUT_MAX_MS (9999 * 60000UL)
 
-#define BATT_PIN 3 // ADC1_CH2 (XIAO pad D2). MUST be ADC1 (GPIO1-10): ADC2 fails while BLE is on.
-#define BATT_SAMPLE_INTERVAL 60000 // re-check battery every 60s while awake
-
-// Battery sense via a 2:1 divider (measured pin mV * BATT_DIVIDER = battery mV).
-// Only a low-battery warning is needed, so we just threshold with hysteresis.
-#define BATT_DIVIDER 2.0f
+// sampling runs in the background (battery.h); this only re-reads the
+// filtered value for the gauge and the low-battery warning
+#define BATT_SAMPLE_INTERVAL 5000
 #define BATT_LOW_MV       3500 // assert low-battery warning at/below this
 #define BATT_CLEAR_MV     3600 // clear it above this (hysteresis to stop flicker)
-#define BATT_VALID_MIN_MV 2800 // below this = USB-powered / no live cell -> no warning
-#define BATT_VALID_MAX_MV 4350 // above this = implausible -> ignore
+#define BATT_GAUGE_STEPS  7    // fill pixels in the bottom-bar gauge
+
+static int8_t battGauge = -1;  // gauge fill shown, -1 = no cell (blank)
 
 const uint8_t ROW_PINS[4] = {42, 2, 4, 43};
 const uint8_t COL_PINS[4] = {9, 8, 7, 44};
@@ -143,34 +209,155 @@ const char KEYMAP[4][4] = {
     {'1', '2', '3', '0'}
 };
 
+// Framebuffer mode. The default full-buffer (_F_) constructor holds the whole
+// 1 KB frame in RAM for the life of the firmware. -DDISPLAY_PAGE_BUFFER=1 (or 2)
+// switches to the page-buffer constructor (128 B / 256 B) and every screen is
+// then rendered through the picture loop in renderFrame().
+#if defined(DISPLAY_PAGE_BUFFER) && DISPLAY_PAGE_BUFFER == 1
+U8G2_SSD1309_128X64_NONAME0_1_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
+#elif defined(DISPLAY_PAGE_BUFFER) && DISPLAY_PAGE_BUFFER == 2
+U8G2_SSD1309_128X64_NONAME0_2_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
+#else
 U8G2_SSD1309_128X64_NONAME0_F_HW_I2C u8g2(U8G2_R0, U8X8_PIN_NONE);
+#endif
 
-String displayValue = "0";
-String storedValue = "";
-char pendingOp = 0;
+// calculator state lives in inline buffers: the keystroke path must not
+// allocate (PERF_LOG builds print the malloc count per key to check)
+#define DISPLAY_ENTRY_MAX 13   // digits the user can type
+#define DISPLAY_RESULT_MAX 13  // results are rounded (or go to 1.2e12 form) to fit
+FixedString<32> displayValue = "0";
+// the value behind a displayed result, at full precision: a result rounded
+// to 13 characters and then used as an operand would lose digits otherwise
+Decimal displayExact = {0};
+bool displayExactValid = false;
+Expr expr;  // operands and operators keyed so far, evaluated on '='
 bool newEntry = true;
 uint32_t lastActivity = 0;
-char lastKey = 0;
 bool bleConnected = false;
 bool usbConnected = true;
 bool lowBattery = false;
+bool displayOn = true;  // panel out of power save (for the energy ledger)
+
+// Idle ladder. The calculator deep-sleeps after sleepTimeoutMs, but numpad
+// mode must keep its USB/BLE link, so it steps down instead: dim the panel and
+// LED, then blank them, then light-sleep between scans with a GPIO wake on the
+// matrix. Dimming applies in both modes; a handled key climbs straight back.
+// A GPIO wake steps back to blank until the keys are let go, since some keys
+// (and the FN tap) only fire on release and need the scan task's 20 ms polling.
+#define IDLE_DIM_MS        30000
+#define IDLE_BLANK_MS      120000  // numpad mode only
+#define IDLE_SLEEP_MS      180000  // numpad mode only, with no USB host and BLE off
+#define IDLE_HELD_RECHECK_MS 1000  // sleep deadline passed with a key down: look again
+#define IDLE_DIM_CONTRAST  8
+enum IdleStage {
+    IDLE_AWAKE,
+    IDLE_DIM,
+    IDLE_BLANK,
+    IDLE_SLEEP
+};
+IdleStage idleStage = IDLE_AWAKE;
+uint64_t idleWokeAt = 0;  // esp_timer time of the last GPIO wake from light sleep
+uint32_t idleWakeLatencyUs = 0;  // that wake to the woken key being dispatched
+uint32_t idleWakeLatencyMaxUs = 0;
+
+// Event-driven loop: every deadline loop() used to poll millis() for is a
+// timer (timers.h), and between passes loop() blocks until the earliest one
+// or an event from another task (tasks.h): the scan task posts key presses,
+// the BLE task link changes. Only the scan task falls back to the 20 ms
+// cadence, and only while a key is down.
+enum LoopTimer : uint8_t {
+    TIMER_BOOT_OVERLAY,
+    TIMER_MESSAGE,
+    TIMER_BLE,
+    TIMER_MEMORY_FLUSH,
+    TIMER_SETTINGS_FLUSH,
+    TIMER_VIEW_REFRESH,  // live BT / Battery / Power views
+    TIMER_BATTERY,
+    TIMER_IDLE,          // next idle-ladder step or deep sleep
+    TIMER_WAKEUP_STATS
+};
+#define LOOP_SCAN_MS       20     // cadence while keys are down
+#define LOOP_WAIT_MAX_MS   60000  // longest block with nothing scheduled
+#define CONSOLE_POLL_MS    100    // block cap while a USB host is attached
+#define BLE_POLL_MS        250    // BLE task's link state check while the stack is up
+#define WAKEUP_WINDOW_MS   10000
+#define UI_EVENT_QUEUE     16
+enum UiEventType : uint8_t {
+    UI_EVENT_KEY,       // a key press from the scan task
+    UI_EVENT_BLE_LINK,  // the BLE task saw the link come or go
+    UI_EVENT_CONSOLE    // bytes arrived on the USB console
+};
+struct UiEvent {
+    uint8_t type;
+    char key;
+};
+QueueHandle_t uiEvents = nullptr;
+TaskHandle_t scanTaskHandle = nullptr;
+TaskHandle_t bleTaskHandle = nullptr;
+SemaphoreHandle_t keyEvent = nullptr;  // given by the column/Enter interrupts
+volatile bool matrixKeysDown = false;  // any matrix key down at the last scan (scan task)
+bool loopPolling = false;              // "pm poll": the old fixed 20 ms loop, for comparison
+uint32_t loopWakeups = 0;              // loop() passes in the current window
+uint32_t loopWakeupRate = 0;           // per second x10, over the last window
 bool numpadMode = false;
 bool numLockOn = true;
-String functionName = "";
+FixedString<15> functionName;
 uint32_t messageUntil = 0;
+const char* messageText = "";  // shown bottom-left until messageUntil
+
+// memory register: lives in rtcState.memory; flash writes wait for a quiet
+// spell so M+ on every receipt doesn't stall the keystroke path
+#define MEMORY_FLUSH_MS 10000
+bool memoryDirty = false;
+uint32_t memoryChangedAt = 0;
+char prevHandledKey = 0;  // for MRC: a second press in a row clears
+
+// settings persistence: changes mark their fields dirty and flushSettings()
+// writes the settings blob once the UI has been quiet for a while (or before
+// sleep), so scrolling through options doesn't put each step into flash
+enum SettingsField : uint8_t {
+    FIELD_SLEEP_MS  = 1 << 0,
+    FIELD_CONTRAST  = 1 << 1,
+    FIELD_LED       = 1 << 2,
+    FIELD_ZOOM      = 1 << 3,
+    FIELD_BATCH_SEP = 1 << 4,
+    FIELD_QBIND     = 1 << 5,
+    FIELD_BOND_META = 1 << 6,
+    FIELD_ENERGY    = 1 << 7,
+    FIELD_ALL       = 0xFF
+};
+#define SETTINGS_FLUSH_MS 3000
+uint8_t settingsDirty = 0;
+uint32_t settingsChangedAt = 0;
+uint32_t nvsWrites = 0;  // keys written to NVS since boot
+
+// staged boot: display, matrix and calculator come up in setup(); the
+// battery ADC primes in bootTask and BLE starts once it is done, so keys
+// work before either finishes
+#define BOOT_OVERLAY_MS 2000
+uint32_t bootOverlayUntil = 0;          // logo overlay deadline (0 = hidden)
+volatile bool bootBackgroundDone = false;
+bool bootFinished = false;
 
 enum MenuPage {
     MENU_PAGE_MACROS = 0,
     MENU_PAGE_SETTINGS,
+    MENU_PAGE_HISTORY,
+    MENU_PAGE_TAPE,
     MENU_PAGE_COUNT
 };
 uint8_t menuPage = MENU_PAGE_MACROS;
+uint8_t historyIndex = 0;  // selected entry on the history page, 0 = newest
+uint32_t tapeScroll = 0;   // tape page: age of the bottom line, 0 = newest
+uint8_t powerScroll = 0;   // Power view: first row shown
 
 // persistent settings
 uint32_t sleepTimeoutMs = DEFAULT_SLEEP_TIMEOUT;
 uint8_t oledContrast = 255;
 uint8_t ledBrightness = 255;
 uint8_t zoomModifier = 0;  // 0 = Ctrl (Windows/Linux), 1 = Cmd/GUI (macOS)
+bool guided = false;       // first-boot guide has been shown
+uint8_t batchSeparator = 0;  // typed after each batch result: 0 = Tab, 1 = Enter
 
 // settings page sub-views
 enum SettingsView {
@@ -188,11 +375,14 @@ enum SettingsView {
     SETTINGS_VIEW_BT_BOND_OS,
     SETTINGS_VIEW_BT_FORGET,
     SETTINGS_VIEW_ZOOM_PICK,
-    SETTINGS_VIEW_BATTERY
+    SETTINGS_VIEW_BATTERY,
+    SETTINGS_VIEW_BATCH_SEP,
+    SETTINGS_VIEW_POWER,
+    SETTINGS_VIEW_COUNT
 };
 SettingsView settingsView = SETTINGS_VIEW_LIST;
 uint8_t settingsIndex = 0;
-String settingsInput = "";
+FixedString<4> settingsInput;
 
 // BLE state
 enum BleMode {
@@ -236,7 +426,7 @@ int8_t qbindSlots[10] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
 const uint8_t QBIND_VALID_SLOTS[9] = {0, 1, 2, 3, 4, 6, 7, 8, 9};
 uint8_t qbindListIdx = 0;     // selection within QBIND_LIST (0..8 -> QBIND_VALID_SLOTS[idx])
 uint8_t qbindEditSlot = 0;    // slot being edited in QBIND_PICK
-uint8_t qbindPickIdx = 0;     // selection in QBIND_PICK (0 = None, 1..MACRO_COUNT = macro)
+uint8_t qbindPickIdx = 0;     // selection in QBIND_PICK (0 = None, 1..macroCount() = macro)
 
 // Settings menu order. SETTINGS_NAMES below MUST stay in this exact order, and
 // the select switch in handleKey() must use these names (not raw indices), so
@@ -249,7 +439,9 @@ enum SettingsItem {
     SET_SLEEP_TIMEOUT,
     SET_CONTRAST,
     SET_QUICK_BIND,
+    SET_BATCH_SEP,
     SET_BATTERY,
+    SET_POWER,
     SET_FW_INFO,
     SET_FACTORY_RESET
 };
@@ -262,7 +454,9 @@ const char* SETTINGS_NAMES[] = {
     "Sleep Timeout",
     "Contrast",
     "Quick Bind",
+    "Batch Separator",
     "Battery",
+    "Power",
     "FW Info",
     "Factory Reset"
 };
@@ -277,16 +471,24 @@ bool fnSlashPressed = false; // for mode toggle
 bool fnClearPressed = false; // for send answer
 
 void initMatrix();
+void initKeyEvents();
+void scanPause();
+void scanResume();
+static void startAppTasks();
 char scanMatrix();
 char scanWakeKey();
 void handleKey(char key);
-void showBootScreen();
+void showBootOverlay();
 void introMode();
 void drawMenu();
+static void renderFrame(void (*draw)());
 void drawMenuHeader(const char* title);
 void drawMacroPage();
 void drawSettingsPage();
-void saveSettings();
+void drawHistoryPage();
+void drawTapePage();
+void markSettingsDirty(uint8_t fields);
+void flushSettings();
 void factoryReset();
 void handleSettingsKey(char key);
 void bleStartAdvertising();
@@ -305,13 +507,10 @@ void drawBottomBar();
 void drawMainDisplay();
 void updateDisplay();
 void setFunction(const char* name);
+void showMessage(const char* text);
 void clearFunction();
-double calculate(double a, double b, char op);
-String formatResult(double result);
+void formatResult(Decimal result, char* out, size_t size);
 void goToSleep();
-void initBattery();
-static int readBatteryPinMv();
-static int readBatteryMv();
 void updateBattery();
 void showGuide();
 bool waitForEnter();
@@ -332,6 +531,7 @@ void initMatrix() {
 
 char scanMatrix() {
     char pressed = 0;
+    matrixKeysDown = false;
     bool currentMinus = false;
     bool currentEight = false;
     bool currentTwo = false;
@@ -346,6 +546,7 @@ char scanMatrix() {
 
         for (int col = 0; col < 4; col++) {
             if (digitalRead(COL_PINS[col]) == LOW) {
+                matrixKeysDown = true;
                 char key = KEYMAP[row][col];
                 if (key == '-') currentMinus = true;
                 else if (key == '8') currentEight = true;
@@ -366,6 +567,7 @@ char scanMatrix() {
     static bool prevMinus = false;
     static bool prevFive = false;
     static bool minusFnUsed = false;
+    static bool minusChordUsed = false;  // '-' held for a calc chord (see handleKey)
     static bool fiveFnUsed = false;
     bool minusReleased = prevMinus && !currentMinus;
     bool fiveReleased  = prevFive  && !currentFive;
@@ -414,12 +616,9 @@ char scanMatrix() {
         bool wasTap = !fnComboFired;
         fnComboFired = false;
         // consume release events so - and 5 don't fire on release
-        if (minusReleased) { minusReleased = false; minusFnUsed = false; }
+        if (minusReleased) { minusReleased = false; minusFnUsed = false; minusChordUsed = false; }
         if (fiveReleased)  { fiveReleased  = false; fiveFnUsed  = false; }
-        if (wasTap && macro.state == MACRO_IDLE) {
-            macroMenuOpen();
-            return 'M';
-        }
+        if (wasTap) return 'M';
         return 0;
     }
 
@@ -432,28 +631,46 @@ char scanMatrix() {
     }
     if (!currentMinus || !currentSlash) minusSlashChord = false;
 
-    // - + * = send answer (calc mode only)
+    // The chords below only mean something in calc mode, and the mode belongs
+    // to the UI task, so they're reported in both and handleKey() turns them
+    // back into plain keys in numpad mode. '-' is then released as 'U' rather
+    // than '-', so it is typed in numpad mode and dropped in calc mode.
+
+    // - + * = send answer ('S')
     static bool minusStarChord = false;
-    if (!numpadMode && currentMinus && currentStar && !minusStarChord) {
+    if (currentMinus && currentStar && !minusStarChord) {
         minusStarChord = true;
-        minusFnUsed = true;
-        return 'A';
+        minusChordUsed = true;
+        return 'S';
     }
     if (!currentMinus || !currentStar) minusStarChord = false;
 
+    // - + '+' / '.' / C = memory M+ / M- / MRC. Returned on every scan while
+    // held; the scan task only posts the first.
+    if (currentMinus) {
+        char memKey = 0;
+        if (pressed == '+') memKey = 'P';
+        else if (pressed == '.') memKey = 'N';
+        else if (currentClear) memKey = 'R';
+        if (memKey) {
+            minusChordUsed = true;
+            return memKey;
+        }
+    }
+
     // FN + digit = quick-bind macro trigger (calc mode only; in numpad mode
     // '-'+digit is normal typing). FN here is just '-' held; the digit (0-9
     // except 5) picks the slot. '-'+'5' is the macro-menu chord, so slot 5
     // can't be a quick bind. (8/2 are tracked specially; the other digits live
     // in `pressed`.)
-    if (!numpadMode && currentMinus) {
+    if (currentMinus) {
         char qbDigit = 0;
         if (pressed >= '0' && pressed <= '9') qbDigit = pressed;
         else if (currentEight) qbDigit = '8';
         else if (currentTwo)   qbDigit = '2';
 
         if (qbDigit && qbDigit != '5') {
-            minusFnUsed = true;  // consume '-' so it doesn't emit minus on release
+            minusChordUsed = true;  // '-' is released as 'U', not '-'
             return (char)(0x10 + (qbDigit - '0'));  // 0x10..0x19, skipping 0x15
         }
     }
@@ -461,8 +678,10 @@ char scanMatrix() {
     // minus/five fire on release, and only if they weren't part of an FN chord
     if (minusReleased) {
         bool wasSolo = !minusFnUsed;
+        bool wasChord = minusChordUsed;
         minusFnUsed = false;
-        if (wasSolo) return '-';
+        minusChordUsed = false;
+        if (wasSolo) return wasChord ? 'U' : '-';
     }
     // five fires on press when minus is not held — no FN chord is possible
     static bool fiveFiredOnPress = false;
@@ -497,13 +716,169 @@ char scanWakeKey() {
 }
 
 
+void showMessage(const char* text) {
+    messageText = text;
+    messageUntil = millis() + 5000;
+}
+
+
+// the display as a number; an empty entry (just after an operator) is 0.
+// Typed digits are capped at what parses, so a failure here is a bug
+// upstream; it is reported rather than silently becoming 0
+static Decimal displayDecimal() {
+    Decimal v = {0};
+    char shown[DISPLAY_RESULT_MAX + 1];
+    if (displayExactValid) {
+        // still the value we put there, not something typed or cleared since
+        formatResult(displayExact, shown, sizeof(shown));
+        if (strcmp(shown, displayValue.c_str()) == 0) return displayExact;
+        displayExactValid = false;
+    }
+    if (!decParse(displayValue.c_str(), &v)) showMessage("OVERFLOW");
+    return v;
+}
+
+
+// show a value, keeping its exact form for when it is used as an operand
+static void displaySet(Decimal v) {
+    char buf[DISPLAY_RESULT_MAX + 1];
+    formatResult(v, buf, sizeof(buf));
+    displayValue = buf;
+    displayExact = v;
+    displayExactValid = true;
+}
+
+
+// put a computed result on the display, or 0 plus a warning if it overflowed
+static void showResult(bool ok, Decimal result) {
+    if (!ok) {
+        displayValue = "0";
+        showMessage("OVERFLOW");
+        return;
+    }
+    displaySet(result);
+    historyPush(result);
+    tapeAppend(result, 'T');
+}
+
+
+// queue a batch result for the host at full precision, then the separator
+static void typeBatchResult(Decimal result) {
+    char buf[32];
+    size_t len = decFormat(result, buf, sizeof(buf) - 1);
+    buf[len++] = batchSeparator == 1 ? '\n' : '\t';
+    buf[len] = 0;
+    if (!hidQueueString(buf)) showMessage("QUEUE FULL");
+}
+
+
+static uint8_t statView = STAT_MEAN;  // StatKind shown on the top bar in stats mode
+
+static void handleStatsKey(char key) {
+    if (key == '/') {
+        statView = (statView + 1) % STAT_KIND_COUNT;
+        statsSelect((StatKind)statView);
+        return;
+    }
+    if (statView == STAT_RESET) {
+        statsClear();
+        statView = STAT_MEAN;
+        statsSelect(STAT_MEAN);
+        showMessage("STATS CLEARED");
+        return;
+    }
+    double v;
+    Decimal d;
+    if (!statsValue((StatKind)statView, &v) || !decFromDouble(v, &d)) {
+        showMessage("N/A");
+        return;
+    }
+    displaySet(d);
+    newEntry = true;
+}
+
+
+// M+ / M- fold in the displayed value (finishing a pending expression first,
+// like '='); MRC recalls, and a second MRC in a row clears the register
+static void handleMemoryKey(char key, char prevKey) {
+    if (key == 'R') {
+        if (prevKey == 'R') {
+            rtcState.memory.raw = 0;
+            showMessage("MEMORY CLEARED");
+        } else {
+            displaySet(rtcState.memory);
+            newEntry = true;
+            return;
+        }
+    } else {
+        Decimal value = displayDecimal();
+        if (!exprIsEmpty(&expr)) {
+            Decimal operand = value;
+            if (!newEntry) tapeAppend(operand, '=');
+            bool ok = exprEvaluate(&expr, newEntry ? nullptr : &operand, &value);
+            exprClear(&expr);
+            showResult(ok, value);
+            if (!ok) return;
+        }
+        newEntry = true;
+        bool ok = key == 'P' ? decAdd(rtcState.memory, value, &rtcState.memory)
+                             : decSub(rtcState.memory, value, &rtcState.memory);
+        if (!ok) {
+            showMessage("OVERFLOW");
+            return;
+        }
+    }
+    rtcStateSeal();
+    memoryDirty = true;
+    memoryChangedAt = millis();
+}
+
+
+// write the register to NVS; called after a quiet period and before sleep
+static void flushMemory() {
+    if (!memoryDirty) return;
+    Preferences p;
+    p.begin("t2", false);
+    p.putLong64("mem", rtcState.memory.raw);
+    p.end();
+    nvsWrites++;
+    memoryDirty = false;
+}
+
+
+// In numpad mode the '-' chords scanMatrix() reports are just the keys
+// pressed: the chorded key, then '-' when it's released. 0 drops the key.
+static char numpadChordKey(char key) {
+    switch (key) {
+        case 'S': return 0;  // '*' is never typed while '-' is held
+        case 'P': return '+';
+        case 'N': return '.';
+        case 'R': return 'C';
+        case 'U': return '-';
+    }
+    if (key >= 0x10 && key <= 0x19) return (char)('0' + (key - 0x10));
+    return key;
+}
+
+
 void handleKey(char key) {
+    if (numpadMode) key = numpadChordKey(key);
+    else if (key == 'S') key = 'A';
+    else if (key == 'U') key = 0;  // '-' was part of a chord
+    if (!key) return;
+
     lastActivity = millis();
-    messageUntil = 0; // any keypress dismisses the RESULT SENT message
+    messageUntil = 0; // any keypress dismisses the bottom-bar message
+    char prevKey = prevHandledKey;
+    prevHandledKey = key;
 
-    // menu just opened
+    // FN tap: open the menu
     if (key == 'M') {
+        if (macro.state != MACRO_IDLE) return;
+        macroMenuOpen();
         menuPage = MENU_PAGE_MACROS;
+        historyIndex = 0;
+        tapeScroll = 0;
         settingsView = SETTINGS_VIEW_LIST;
         settingsInput = "";
         drawMenu();
@@ -549,7 +924,17 @@ void handleKey(char key) {
             }
             if (key == '5' || key == '=') {
                 macroMenuSelect();
-                functionName = macro.functionName;
+                functionName = macroName(macro.index);
+                displayValue = "0";
+                newEntry = true;
+                updateDisplay();
+                return;
+            }
+            if (key == '.') {
+                // batch: same prompts once, then every amount types a result
+                macroStartBatch(menuIndex);
+                hidInit();
+                functionName = macroName(macro.index);
                 displayValue = "0";
                 newEntry = true;
                 updateDisplay();
@@ -579,7 +964,9 @@ void handleKey(char key) {
                         settingsView = SETTINGS_VIEW_BRIGHTNESS;
                         break;
                     case SET_SHOW_GUIDE:
+                        scanPause();  // the guide reads the matrix itself
                         showGuide();
+                        scanResume();
                         break;
                     case SET_SLEEP_TIMEOUT:
                         settingsView = SETTINGS_VIEW_TIMEOUT;
@@ -591,9 +978,16 @@ void handleKey(char key) {
                     case SET_QUICK_BIND:
                         settingsView = SETTINGS_VIEW_QBIND_LIST;
                         break;
+                    case SET_BATCH_SEP:
+                        settingsView = SETTINGS_VIEW_BATCH_SEP;
+                        break;
                     case SET_BATTERY:
                         settingsView = SETTINGS_VIEW_BATTERY;
                         break;
+                    case SET_POWER:
+                        settingsView = SETTINGS_VIEW_POWER;
+                        powerScroll = 0;
+                        break;
                     case SET_FW_INFO:
                         settingsView = SETTINGS_VIEW_FW_INFO;
                         break;
@@ -605,6 +999,46 @@ void handleKey(char key) {
                 return;
             }
         }
+        else if (menuPage == MENU_PAGE_HISTORY) {
+            if (key == '8') {
+                if (historyIndex > 0) historyIndex--;
+                drawMenu();
+                return;
+            }
+            if (key == '2') {
+                if (historyIndex + 1 < historyCount()) historyIndex++;
+                drawMenu();
+                return;
+            }
+            if ((key == '5' || key == '=') && historyIndex < historyCount()) {
+                // recall: the value becomes the current entry
+                displaySet(historyGet(historyIndex));
+                newEntry = true;
+                macro.state = MACRO_IDLE;
+                updateDisplay();
+                return;
+            }
+        }
+        else if (menuPage == MENU_PAGE_TAPE) {
+            // 8 scrolls back up the tape, 2 toward the newest line
+            if (key == '8') {
+                if (tapeScroll + 1 < tapeCount()) tapeScroll++;
+                drawMenu();
+                return;
+            }
+            if (key == '2') {
+                if (tapeScroll > 0) tapeScroll--;
+                drawMenu();
+                return;
+            }
+            if ((key == '5' || key == '=') && tapeScroll < tapeCount()) {
+                displaySet(Decimal{tapeGet(tapeScroll).raw});
+                newEntry = true;
+                macro.state = MACRO_IDLE;
+                updateDisplay();
+                return;
+            }
+        }
         return; // ignore other keys while menu is open
     }
 
@@ -615,8 +1049,7 @@ void handleKey(char key) {
             hidInit();
             functionName = "";
             displayValue = "0";
-            storedValue = "";
-            pendingOp = 0;
+            exprClear(&expr);
             newEntry = true;
         }
         updateDisplay();
@@ -626,24 +1059,23 @@ void handleKey(char key) {
     // send answer to computer
     if (key == 'A') {
         hidInit();
-        hidSendString(displayValue);
-        messageUntil = millis() + 5000;
+        hidSendString(displayValue.c_str());
+        showMessage("RESULT SENT");
         updateDisplay();
         return;
     }
 
     // quick-bind macro trigger: FN+digit (0-9 except 5)
     if (key >= 0x10 && key <= 0x19) {
-        if (numpadMode || macro.state != MACRO_IDLE) return;
+        if (macro.state != MACRO_IDLE) return;
         uint8_t slot = key - 0x10;
         if (slot == 5) return;
-        int8_t macroIdx = qbindSlots[slot];
-        if (macroIdx < 0 || macroIdx >= (int8_t)MACRO_COUNT) return;
-        macroStart(MACRO_NAMES[macroIdx]);
-        functionName = macro.functionName;
+        int macroIdx = macroFromRef(qbindSlots[slot]);
+        if (macroIdx < 0) return;
+        macroStart(macroIdx);
+        functionName = macroName(macro.index);
         displayValue = "0";
-        storedValue = "";
-        pendingOp = 0;
+        exprClear(&expr);
         newEntry = true;
         updateDisplay();
         return;
@@ -660,14 +1092,53 @@ void handleKey(char key) {
         return;
     }
     
-    // macro input
+    // memory register
+    if (key == 'P' || key == 'N' || key == 'R') {
+        handleMemoryKey(key, prevKey);
+        updateDisplay();
+        return;
+    }
+
+    // stats mode: '/' steps through the statistics, '*' recalls the one shown
+    if (macro.state == MACRO_AWAITING_INPUT && macro.stream) {
+        if (key == '/' || key == '*') {
+            handleStatsKey(key);
+            updateDisplay();
+            return;
+        }
+        // a second Enter with nothing typed would add a stray 0
+        if (key == '=' && newEntry && exprIsEmpty(&expr)) return;
+    }
+
+    // macro input; a pending expression is worked out first, so "0-5 =" enters -5
     if (macro.state == MACRO_AWAITING_INPUT && key == '=') {
-        double value = displayValue.toDouble();
-        
+        Decimal value = displayDecimal();
+        if (!exprIsEmpty(&expr)) {
+            Decimal operand = value;
+            if (!newEntry) tapeAppend(operand, '=');
+            bool ok = exprEvaluate(&expr, newEntry ? nullptr : &operand, &value);
+            exprClear(&expr);
+            if (!ok) {
+                showResult(false, value);
+                newEntry = true;
+                updateDisplay();
+                return;
+            }
+        }
+        tapeAppend(value, 'P');
         if (macroInput(value)) {
-            displayValue = formatResult(macro.result);
-            macro.state = MACRO_IDLE;
-            functionName = "";
+            if (macro.stream) {
+                // the entry went into the column; the top bar shows the stat
+                displayValue = "0";
+            } else {
+                showResult(!macro.failed, macro.result);
+                if (macro.batch) {
+                    if (!macro.failed) typeBatchResult(macro.result);
+                } else {
+                    macro.state = MACRO_IDLE;
+                    functionName = "";
+                }
+            }
         } else {
             displayValue = "0";
         }
@@ -678,16 +1149,24 @@ void handleKey(char key) {
     
     // normal calculator keys
     if (key >= '0' && key <= '9') {
+        displayExactValid = false;
         if (newEntry) {
             displayValue = key;
             newEntry = false;
         } else {
-            if (displayValue.length() < 13) {
+            if (displayValue.length() < DISPLAY_ENTRY_MAX) {
+                // 13 integer digits can pass what a Decimal holds (~9.2e12)
                 displayValue += key;
+                Decimal probe;
+                if (!decParse(displayValue.c_str(), &probe)) {
+                    displayValue.removeLast();
+                    showMessage("OVERFLOW");
+                }
             }
         }
     }
     else if (key == '.') {
+        displayExactValid = false;
         if (newEntry) {
             displayValue = "0.";
             newEntry = false;
@@ -696,30 +1175,36 @@ void handleKey(char key) {
         }
     }
     else if (key == '+' || key == '-' || key == '*' || key == '/') {
-        if (newEntry && storedValue.length() > 0 && pendingOp) {
+        if (newEntry && exprEndsWithOp(&expr)) {
             // no new operand typed yet — just swap the operator
-            pendingOp = key;
+            exprSetOp(&expr, key);
+            tapeRetag(key);
         } else {
-            if (storedValue.length() > 0 && pendingOp && !newEntry) {
-                double a = storedValue.toDouble();
-                double b = displayValue.toDouble();
-                double result = calculate(a, b, pendingOp);
-                displayValue = formatResult(result);
+            Decimal operand = displayDecimal();
+            if (!exprHasRoom(&expr)) {
+                // tape full: fold it into one number and keep going
+                bool ok = exprEvaluate(&expr, &operand, &operand);
+                exprClear(&expr);
+                if (!ok) {
+                    showResult(false, operand);
+                    newEntry = true;
+                    updateDisplay();
+                    return;
+                }
             }
-            storedValue = displayValue;
-            pendingOp = key;
-            displayValue = "";
+            exprPush(&expr, operand, key);
+            tapeAppend(operand, key);
+            displayValue.clear();
             newEntry = true;
         }
     }
     else if (key == '=') {
-        if (storedValue.length() > 0 && pendingOp) {
-            double a = storedValue.toDouble();
-            double b = displayValue.toDouble();
-            double result = calculate(a, b, pendingOp);
-            displayValue = formatResult(result);
-            storedValue = "";
-            pendingOp = 0;
+        if (!exprIsEmpty(&expr)) {
+            Decimal operand = displayDecimal(), result = {0};
+            if (!newEntry) tapeAppend(operand, '=');
+            bool ok = exprEvaluate(&expr, newEntry ? nullptr : &operand, &result);
+            showResult(ok, result);
+            exprClear(&expr);
             newEntry = true;
         }
     }
@@ -727,9 +1212,8 @@ void handleKey(char key) {
         if (displayValue.length() > 0) {
             displayValue = "";
             newEntry = true;
-        } else if (storedValue.length() > 0 || pendingOp) {
-            storedValue = "";
-            pendingOp = 0;
+        } else if (!exprIsEmpty(&expr)) {
+            exprClear(&expr);
         } else if (macro.state == MACRO_AWAITING_INPUT) {
             macroCancel();
             functionName = "";
@@ -742,22 +1226,86 @@ void handleKey(char key) {
 }
 
 
-void showBootScreen() {
+#ifdef PERF_LOG
+static uint32_t i2cBytes = 0;
+static u8x8_msg_cb i2cByteCb = nullptr;
+
+// wraps U8g2's byte-level I2C callback to count what actually goes on the bus
+static uint8_t countI2cBytes(u8x8_t* u8x8, uint8_t msg, uint8_t argInt, void* argPtr) {
+    if (msg == U8X8_MSG_BYTE_SEND) i2cBytes += argInt;
+    return i2cByteCb(u8x8, msg, argInt, argPtr);
+}
+#endif
+
+static void (*lastFrameDraw)() = nullptr;  // re-rendered for console screenshots
+static uint8_t* captureBuf = nullptr;      // 1 KB target while a screenshot is taken
+static bool frameLogMuted = false;         // render bench prints its own summary
+
+// copy the buffer's tile rows to their place in the screenshot (the whole
+// frame in full-buffer mode, the current page in page-buffer mode)
+static void captureTiles() {
+    uint16_t rowBytes = u8g2.getBufferTileWidth() * 8;
+    uint16_t offset = u8g2.getBufferCurrTileRow() * rowBytes;
+    memcpy(captureBuf + offset, u8g2.getBufferPtr(), u8g2.getBufferTileHeight() * rowBytes);
+}
+
+
+// Every screen goes through here. draw() must only read state: in page-buffer
+// mode the picture loop calls it once per page (8 or 4 times per frame), so
+// anything sampled (ADC, clocks) has to be captured before the call.
+static void renderFrame(void (*draw)()) {
+#ifdef PERF_LOG
+    uint32_t t0 = micros();
+    uint32_t bytes0 = i2cBytes;
+#endif
+    lastFrameDraw = draw;
+    powerBoost(POWER_RENDER);
+#ifdef DISPLAY_PAGE_BUFFER
+    u8g2.firstPage();
+    do {
+        draw();
+        if (captureBuf) captureTiles();
+    } while (u8g2.nextPage());
+#else
     u8g2.clearBuffer();
+    draw();
+    if (captureBuf) captureTiles();
+    u8g2.sendBuffer();
+#endif
+    powerRelax(POWER_RENDER);
+    if (!frameLogMuted) {
+        PERF_PRINTF("frame: %lu us, %lu B i2c\n",
+                    (unsigned long)(micros() - t0), (unsigned long)(i2cBytes - bytes0));
+    }
+}
+
+
+static void drawBootScreen() {
     u8g2.drawXBM(1, 1, LOGO_WIDTH, LOGO_HEIGHT, LOGO);
     u8g2.setFont(u8g2_font_logisoso16_tr);
     u8g2.drawStr(55, 17, "Tactical");
     u8g2.drawStr(59, 37, "Tenkey");
     u8g2.setFont(u8g2_font_5x7_tr);
     u8g2.drawStr(68, 50, "v " FW_VERSION);
-    u8g2.sendBuffer();
-    delay(2000);
 }
 
 
-void welcomeText() {
+// Cold boot shows the logo as an overlay instead of blocking in delay(): the
+// calculator is already live underneath, and the first keypress (or the
+// timeout) dismisses it.
+void showBootOverlay() {
+    bootOverlayUntil = millis() + BOOT_OVERLAY_MS;
+}
+
+
+static void drawWelcome() {
+    drawBootScreen();
     u8g2.drawStr(10, 64, "Press [Enter] to start");
-    u8g2.sendBuffer();
+}
+
+
+void welcomeText() {
+    renderFrame(drawWelcome);
     waitForEnter();
 }
 
@@ -778,21 +1326,22 @@ void drawMacroPage() {
     // show 3 items centered on current selection
     int startIdx = menuIndex - 1;
     if (startIdx < 0) startIdx = 0;
-    if (startIdx > MACRO_COUNT - 3) startIdx = MACRO_COUNT - 3;
-    if (MACRO_COUNT <= 3) startIdx = 0;
+    uint8_t count = macroCount();
+    if (startIdx > count - 3) startIdx = count - 3;
+    if (count <= 3) startIdx = 0;
 
     u8g2.setFont(u8g2_font_6x10_tr);
-    for (int i = 0; i < 3 && (startIdx + i) < MACRO_COUNT; i++) {
+    for (int i = 0; i < 3 && (startIdx + i) < count; i++) {
         int idx = startIdx + i;
         int y = 25 + (i * 14);
 
         if (idx == menuIndex) {
             u8g2.drawBox(0, y - 10, 128, 14);
             u8g2.setDrawColor(0);
-            u8g2.drawStr(4, y, MACRO_NAMES[idx]);
+            u8g2.drawStr(4, y, macroName(idx));
             u8g2.setDrawColor(1);
         } else {
-            u8g2.drawStr(4, y, MACRO_NAMES[idx]);
+            u8g2.drawStr(4, y, macroName(idx));
         }
     }
     u8g2.setFont(u8g2_font_5x7_tr);
@@ -800,6 +1349,73 @@ void drawMacroPage() {
 }
 
 
+void drawHistoryPage() {
+    drawMenuHeader("HISTORY");
+
+    u8g2.setFont(u8g2_font_6x10_tr);
+    uint8_t count = historyCount();
+    if (count == 0) {
+        u8g2.drawStr(4, 36, "No results yet");
+    }
+    int startIdx = historyIndex - 1;
+    if (startIdx < 0) startIdx = 0;
+    if (startIdx > count - 3) startIdx = count - 3;
+    if (count <= 3) startIdx = 0;
+
+    for (int i = 0; i < 3 && (startIdx + i) < count; i++) {
+        int idx = startIdx + i;
+        int y = 25 + (i * 14);
+        char line[24];
+        int n = snprintf(line, sizeof(line), "%2d ", idx + 1);
+        formatResult(historyGet(idx), line + n, sizeof(line) - n);
+
+        if (idx == historyIndex) {
+            u8g2.drawBox(0, y - 10, 128, 14);
+            u8g2.setDrawColor(0);
+            u8g2.drawStr(4, y, line);
+            u8g2.setDrawColor(1);
+        } else {
+            u8g2.drawStr(4, y, line);
+        }
+    }
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.drawStr(0, 64, "[4][6]Pg [5]Use [NUM]Bk");
+}
+
+
+// paper-tape layout: oldest at the top, the selected (bottom) line inverted
+void drawTapePage() {
+    drawMenuHeader("TAPE");
+
+    u8g2.setFont(u8g2_font_5x7_tr);
+    uint32_t count = tapeCount();
+    if (count == 0) {
+        u8g2.setFont(u8g2_font_6x10_tr);
+        u8g2.drawStr(4, 36, "Tape is empty");
+    }
+    const uint8_t rows = 5;
+    for (uint8_t i = 0; i < rows; i++) {
+        uint32_t age = tapeScroll + (rows - 1 - i);
+        if (age >= count) continue;
+        TapeLine line = tapeGet(age);
+        int y = 21 + i * 8;
+        char num[12], value[24];
+        snprintf(num, sizeof(num), "%lu", (unsigned long)(tapeTotal() - age));
+        formatResult(Decimal{line.raw}, value, sizeof(value));
+        char tag[2] = {line.tag == 'P' ? '>' : line.tag, 0};
+        if (age == tapeScroll) {
+            u8g2.drawBox(0, y - 7, 128, 8);
+            u8g2.setDrawColor(0);
+        }
+        u8g2.drawStr(2, y, num);
+        u8g2.drawStr(118 - u8g2.getStrWidth(value), y, value);
+        u8g2.drawStr(122, y, tag);
+        u8g2.setDrawColor(1);
+    }
+    u8g2.drawStr(0, 64, "[8/2]Scroll [5]Use [NUM]Bk");
+}
+
+
 static void drawSettingsList() {
     int startIdx = settingsIndex - 1;
     if (startIdx < 0) startIdx = 0;
@@ -826,9 +1442,13 @@ static void drawSettingsList() {
 static void drawTimeoutEntry() {
     u8g2.setFont(u8g2_font_6x10_tr);
     u8g2.drawStr(0, 28, "Minutes:");
-    String shown = settingsInput.length() > 0 ? settingsInput : String(sleepTimeoutMs / 60000);
-    shown += "_";
-    u8g2.drawStr(0, 46, shown.c_str());
+    char shown[16];
+    if (settingsInput.length() > 0) {
+        snprintf(shown, sizeof(shown), "%s_", settingsInput.c_str());
+    } else {
+        snprintf(shown, sizeof(shown), "%lu_", (unsigned long)(sleepTimeoutMs / 60000));
+    }
+    u8g2.drawStr(0, 46, shown);
     u8g2.setFont(u8g2_font_5x7_tr);
     u8g2.drawStr(0, 64, "[*]Bksp [=]Sv [NUM]Bk");
 }
@@ -876,8 +1496,8 @@ static void drawQbindList() {
     for (int i = 0; i < 3 && (startIdx + i) < total; i++) {
         int idx = startIdx + i;
         uint8_t slot = QBIND_VALID_SLOTS[idx];
-        int8_t mi = qbindSlots[slot];
-        const char* name = (mi >= 0 && mi < (int8_t)MACRO_COUNT) ? MACRO_NAMES[mi] : "(none)";
+        int mi = macroFromRef(qbindSlots[slot]);
+        const char* name = mi >= 0 ? macroName(mi) : "(none)";
         snprintf(row, sizeof(row), "FN+%u: %s", slot, name);
 
         int y = 25 + (i * 14);
@@ -895,8 +1515,8 @@ static void drawQbindList() {
 }
 
 static void drawQbindPick() {
-    // pick list: 0 = "(none)", 1..MACRO_COUNT = macros
-    int total = MACRO_COUNT + 1;
+    // pick list: 0 = "(none)", 1..macroCount() = macros
+    int total = macroCount() + 1;
     int startIdx = (int)qbindPickIdx - 1;
     if (startIdx < 0) startIdx = 0;
     if (startIdx > total - 3) startIdx = total - 3;
@@ -905,7 +1525,7 @@ static void drawQbindPick() {
     u8g2.setFont(u8g2_font_6x10_tr);
     for (int i = 0; i < 3 && (startIdx + i) < total; i++) {
         int idx = startIdx + i;
-        const char* name = (idx == 0) ? "(none)" : MACRO_NAMES[idx - 1];
+        const char* name = (idx == 0) ? "(none)" : macroName(idx - 1);
         int y = 25 + (i * 14);
         if (idx == (int)qbindPickIdx) {
             u8g2.drawBox(0, y - 10, 128, 14);
@@ -945,6 +1565,24 @@ static void drawZoomPick() {
     u8g2.drawStr(0, 64, "[8/2]Nav [5]Save [NUM]Bk");
 }
 
+static void drawBatchSepPick() {
+    const char* options[2] = { "Tab", "Enter" };
+    u8g2.setFont(u8g2_font_6x10_tr);
+    for (int i = 0; i < 2; i++) {
+        int y = 28 + (i * 14);
+        if (i == batchSeparator) {
+            u8g2.drawBox(0, y - 10, 128, 14);
+            u8g2.setDrawColor(0);
+            u8g2.drawStr(4, y, options[i]);
+            u8g2.setDrawColor(1);
+        } else {
+            u8g2.drawStr(4, y, options[i]);
+        }
+    }
+    u8g2.setFont(u8g2_font_5x7_tr);
+    u8g2.drawStr(0, 64, "[8/2]Nav [5]Save [NUM]Bk");
+}
+
 
 static void drawBTBondsList() {
     if (btBondCount == 0) {
@@ -1095,12 +1733,18 @@ static void drawFwInfo() {
 
 static void drawBatteryInfo() {
     // live readout — also the bench tool for calibrating BATT_DIVIDER against
-    // a multimeter (compare "batt" mV to the cell, "pin" mV to the tap node)
-    int pinMv = readBatteryPinMv();
-    int battMv = (int)(pinMv * BATT_DIVIDER);
+    // a multimeter (compare "batt" mV to the cell, "pin" mV to the tap node).
+    // Shows the filtered value and the latest ring median, refreshed each second.
+    int pinMv = batteryPinMv();
+    int battMv = batteryMv();
+    int percent = batteryPercent();
     char line[24];
     u8g2.setFont(u8g2_font_6x10_tr);
-    snprintf(line, sizeof(line), "%d.%03d V", battMv / 1000, battMv % 1000);
+    if (percent >= 0) {
+        snprintf(line, sizeof(line), "%d.%03d V  %d%%", battMv / 1000, battMv % 1000, percent);
+    } else {
+        snprintf(line, sizeof(line), "%d.%03d V  USB", battMv / 1000, battMv % 1000);
+    }
     u8g2.drawStr(0, 30, line);
     u8g2.setFont(u8g2_font_5x7_tr);
     snprintf(line, sizeof(line), "batt: %d mV", battMv);
@@ -1110,6 +1754,51 @@ static void drawBatteryInfo() {
     u8g2.drawStr(0, 64, "[NUM] Back");
 }
 
+// "12s", "4m05s", "3h07m", "12d04h"
+static void formatDuration(uint64_t ms, char* out, size_t size) {
+    uint64_t s = ms / 1000;
+    if (s < 60) {
+        snprintf(out, size, "%lus", (unsigned long)s);
+    } else if (s < 3600) {
+        snprintf(out, size, "%lum%02lus", (unsigned long)(s / 60), (unsigned long)(s % 60));
+    } else if (s < 86400) {
+        snprintf(out, size, "%luh%02lum", (unsigned long)(s / 3600), (unsigned long)(s / 60 % 60));
+    } else {
+        snprintf(out, size, "%lud%02luh", (unsigned long)(s / 86400), (unsigned long)(s / 3600 % 24));
+    }
+}
+
+
+// "1234.5" mAh from uAh
+static void formatMah(uint64_t uah, char* out, size_t size) {
+    snprintf(out, size, "%lu.%lu", (unsigned long)(uah / 1000), (unsigned long)(uah / 100 % 10));
+}
+
+
+#define POWER_VIEW_ROWS 5
+
+static void drawPowerInfo() {
+    // residency and estimated charge per state since the RTC ledger started;
+    // rows overlap (see energy.h), the total is their sum
+    u8g2.setFont(u8g2_font_5x7_tr);
+    char line[28], dur[10], mah[12];
+    for (uint8_t i = 0; i < POWER_VIEW_ROWS && powerScroll + i < ENERGY_ROW_COUNT; i++) {
+        EnergyRow row = (EnergyRow)(powerScroll + i);
+        formatDuration(energyRowMs(row), dur, sizeof(dur));
+        formatMah(energyRowUah(row), mah, sizeof(mah));
+        snprintf(line, sizeof(line), "%-8s %7s %7s", energyRowName(row), dur, mah);
+        u8g2.drawStr(0, 21 + i * 8, line);
+    }
+    formatMah(energyTotalUah(), mah, sizeof(mah));
+    snprintf(line, sizeof(line), "Total %s mAh", mah);
+    u8g2.drawStr(0, 64, line);
+    if (powerScroll > 0) u8g2.drawTriangle(124, 15, 127, 19, 121, 19);
+    if (powerScroll + POWER_VIEW_ROWS < ENERGY_ROW_COUNT) {
+        u8g2.drawTriangle(124, 64, 127, 60, 121, 60);
+    }
+}
+
+
 void drawSettingsPage() {
     if (settingsView == SETTINGS_VIEW_LIST) {
         drawMenuHeader("SETTINGS");
@@ -1137,6 +1826,10 @@ void drawSettingsPage() {
         u8g2.drawStr(0, 10, "HOST OS");
     } else if (settingsView == SETTINGS_VIEW_BATTERY) {
         u8g2.drawStr(0, 10, "BATTERY");
+    } else if (settingsView == SETTINGS_VIEW_POWER) {
+        u8g2.drawStr(0, 10, "POWER");
+    } else if (settingsView == SETTINGS_VIEW_BATCH_SEP) {
+        u8g2.drawStr(0, 10, "BATCH SEPARATOR");
     } else if (settingsView == SETTINGS_VIEW_CONTRAST) {
         u8g2.drawStr(0, 10, "CONTRAST");
     } else if (settingsView == SETTINGS_VIEW_BRIGHTNESS) {
@@ -1168,67 +1861,246 @@ void drawSettingsPage() {
         case SETTINGS_VIEW_BT_FORGET:   drawBTForgetConfirm(); break;
         case SETTINGS_VIEW_ZOOM_PICK:   drawZoomPick(); break;
         case SETTINGS_VIEW_BATTERY:     drawBatteryInfo(); break;
+        case SETTINGS_VIEW_BATCH_SEP:   drawBatchSepPick(); break;
+        case SETTINGS_VIEW_POWER:       drawPowerInfo(); break;
         default: break;
     }
 }
 
 
-void saveSettings() {
-    Preferences p;
-    p.begin("t2", false);
-    p.putULong("sleepMs", sleepTimeoutMs);
-    p.putUChar("contrast", oledContrast);
-    p.putUChar("ledBri", ledBrightness);
-    p.putUChar("zoomMod", zoomModifier);
-    p.putBytes("qbind", qbindSlots, sizeof(qbindSlots));
-    p.putUChar("bmCnt", bondMetaCount);
-    p.putBytes("bmData", bondMetaList, bondMetaCount * sizeof(BondMeta));
-    p.end();
+void markSettingsDirty(uint8_t fields) {
+    settingsDirty |= fields;
+    settingsChangedAt = millis();
 }
 
 
-void factoryReset() {
-    Preferences p;
-    p.begin("t2", false);
-    p.clear();  // wipes everything including the "guided" first-boot flag
-    p.end();
+// Every persistent setting in one NVS blob ("cfg"), so boot restores them
+// with a single lookup. Fields are only ever appended: a blob written by an
+// older version is shorter, and whatever it lacks keeps its default.
+#define SETTINGS_VERSION 3  // 2: energy coefficients, 3: quick binds hold macro refs
+
+// registry size when version 1-2 blobs were written; their quick binds are
+// raw indices, with user formulas from here up
+#define SETTINGS_V2_FORMULA_BASE 13
+
+struct SettingsHeader {
+    uint16_t version;
+    uint16_t length;  // payload bytes after the header
+    uint32_t crc;     // over the payload
+};
+
+struct SettingsBlob {
+    SettingsHeader header;
+    uint32_t sleepMs;
+    uint8_t contrast;
+    uint8_t ledBri;
+    uint8_t zoomMod;
+    uint8_t batchSep;
+    uint8_t guided;
+    int8_t qbind[10];
+    uint8_t bondMetaCount;
+    BondMeta bondMeta[BT_BOND_MAX];
+    uint16_t energyUa[ENERGY_ROW_COUNT];
+};
+
+// the per-setting keys this replaced; read once to migrate, then removed
+static const char* const LEGACY_SETTINGS_KEYS[] = {
+    "sleepMs", "contrast", "ledBri", "zoomMod", "batchSep", "qbind", "bmCnt", "bmData", "guided"
+};
+
+
+static uint32_t settingsCrc(const SettingsBlob* b, uint16_t length) {
+    return esp_rom_crc32_le(0, (const uint8_t*)b + sizeof(SettingsHeader), length);
+}
 
+
+static void defaultSettings() {
     sleepTimeoutMs = DEFAULT_SLEEP_TIMEOUT;
     oledContrast = 255;
     ledBrightness = 255;
     zoomModifier = 0;
+    batchSeparator = 0;
+    guided = false;
     bondMetaCount = 0;
     for (int i = 0; i < 10; i++) qbindSlots[i] = -1;
+    energyDefaults();
+}
 
-    bleShutdown();
-    hidBleClearAllBonds();
 
-    u8g2.setContrast(oledContrast);
-    analogWrite(LED_PIN, ledBrightness);
+static void migrateQbindIndices(int8_t* slots) {
+    for (int i = 0; i < 10; i++) {
+        if (slots[i] >= SETTINGS_V2_FORMULA_BASE) {
+            slots[i] = MACRO_REF_FORMULA + (slots[i] - SETTINGS_V2_FORMULA_BASE);
+        }
+    }
 }
 
 
-// --- bond metadata helpers ---
-
-static bool parseMacString(const String& s, uint8_t* out) {
-    if (s.length() < 17) return false;
-    for (int i = 0; i < 6; i++) {
-        char hex[3] = { s.charAt(i * 3), s.charAt(i * 3 + 1), 0 };
-        out[i] = (uint8_t)strtol(hex, nullptr, 16);
-    }
-    return true;
+static void packSettings(SettingsBlob* b) {
+    memset(b, 0, sizeof(*b));
+    b->sleepMs = sleepTimeoutMs;
+    b->contrast = oledContrast;
+    b->ledBri = ledBrightness;
+    b->zoomMod = zoomModifier;
+    b->batchSep = batchSeparator;
+    b->guided = guided;
+    memcpy(b->qbind, qbindSlots, sizeof(b->qbind));
+    b->bondMetaCount = bondMetaCount;
+    memcpy(b->bondMeta, bondMetaList, sizeof(b->bondMeta));
+    memcpy(b->energyUa, energyUa, sizeof(b->energyUa));
+    b->header.version = SETTINGS_VERSION;
+    b->header.length = sizeof(SettingsBlob) - sizeof(SettingsHeader);
+    b->header.crc = settingsCrc(b, b->header.length);
 }
 
-static int findBondMetaByMac(const uint8_t* mac) {
-    for (uint8_t i = 0; i < bondMetaCount; i++) {
-        if (memcmp(bondMetaList[i].mac, mac, 6) == 0) return i;
-    }
-    return -1;
+
+static void unpackSettings(const SettingsBlob* b) {
+    sleepTimeoutMs = b->sleepMs;
+    oledContrast = b->contrast;
+    ledBrightness = b->ledBri;
+    zoomModifier = b->zoomMod;
+    batchSeparator = b->batchSep;
+    guided = b->guided;
+    memcpy(qbindSlots, b->qbind, sizeof(qbindSlots));
+    if (b->header.version < 3) migrateQbindIndices(qbindSlots);
+    bondMetaCount = b->bondMetaCount <= BT_BOND_MAX ? b->bondMetaCount : 0;
+    memcpy(bondMetaList, b->bondMeta, sizeof(bondMetaList));
+    memcpy(energyUa, b->energyUa, sizeof(energyUa));
 }
 
-static uint8_t getBondOSByMac(const uint8_t* mac) {
-    int idx = findBondMetaByMac(mac);
-    return (idx < 0) ? 0 : bondMetaList[idx].os;
+
+static void writeSettings(Preferences& p) {
+    SettingsBlob b;
+    packSettings(&b);
+    p.putBytes("cfg", &b, sizeof(b));
+    nvsWrites++;
+}
+
+
+// `n` is the bytes actually present, header included
+static bool settingsBlobValid(const SettingsBlob* b, size_t n) {
+    return n >= sizeof(SettingsHeader) && b->header.version <= SETTINGS_VERSION
+        && b->header.length == n - sizeof(SettingsHeader)
+        && b->header.crc == settingsCrc(b, b->header.length);
+}
+
+
+// one read; false if the blob is missing, from a newer version, or corrupt
+static bool loadSettings(Preferences& p) {
+    SettingsBlob b;
+    packSettings(&b);  // defaults for anything an older blob doesn't have
+    size_t n = p.getBytes("cfg", &b, sizeof(b));
+    if (!settingsBlobValid(&b, n)) return false;
+    unpackSettings(&b);
+    return true;
+}
+
+
+// pull settings from the pre-blob keys, if this device has any
+static bool migrateLegacySettings(Preferences& p) {
+    if (!p.isKey("guided") && !p.isKey("sleepMs")) return false;
+    sleepTimeoutMs = p.getULong("sleepMs", DEFAULT_SLEEP_TIMEOUT);
+    oledContrast   = p.getUChar("contrast", 255);
+    ledBrightness  = p.getUChar("ledBri",   255);
+    zoomModifier   = p.getUChar("zoomMod",  0);
+    batchSeparator = p.getUChar("batchSep", 0);
+    guided         = p.getBool("guided", false);
+    if (p.isKey("qbind")) {
+        p.getBytes("qbind", qbindSlots, sizeof(qbindSlots));
+        migrateQbindIndices(qbindSlots);
+    }
+    bondMetaCount = p.getUChar("bmCnt", 0);
+    if (bondMetaCount > BT_BOND_MAX) bondMetaCount = 0;
+    if (bondMetaCount > 0 && p.isKey("bmData")) {
+        p.getBytes("bmData", bondMetaList, bondMetaCount * sizeof(BondMeta));
+    }
+    writeSettings(p);
+    for (const char* key : LEGACY_SETTINGS_KEYS) {
+        if (p.isKey(key)) p.remove(key);
+    }
+    return true;
+}
+
+
+static_assert(sizeof(SettingsBlob) <= RTC_CONFIG_MAX, "settings outgrew the RTC snapshot");
+
+// everything setup() would otherwise read from NVS; goToSleep() takes this
+static void saveConfigSnapshot() {
+    SettingsBlob b;
+    packSettings(&b);
+    memcpy(rtcState.config, &b, sizeof(b));
+    memcpy(rtcState.formulas, formulas, sizeof(rtcState.formulas));
+    rtcState.formulaCount = formulaCount;
+    rtcState.configValid = true;
+    rtcStateSeal();
+}
+
+
+static bool restoreConfigSnapshot() {
+    if (!rtcState.configValid || rtcState.formulaCount > FORMULA_MAX) return false;
+    SettingsBlob b;
+    memcpy(&b, rtcState.config, sizeof(b));
+    unpackSettings(&b);
+    memcpy(formulas, rtcState.formulas, sizeof(formulas));
+    formulaCount = rtcState.formulaCount;
+    return true;
+}
+
+
+void flushSettings() {
+    if (!settingsDirty) return;
+    Preferences p;
+    p.begin("t2", false);
+    writeSettings(p);
+    p.end();
+    PERF_PRINTF("nvs: settings blob written (fields 0x%02x), %lu writes this session\n",
+                settingsDirty, (unsigned long)nvsWrites);
+    settingsDirty = 0;
+}
+
+
+void factoryReset() {
+    settingsDirty = 0;  // about to be wiped anyway; don't write them first
+    Preferences p;
+    p.begin("t2", false);
+    p.clear();  // wipes everything including the "guided" first-boot flag
+    p.end();
+
+    defaultSettings();
+    formulaClearAll();
+    rtcState.memory.raw = 0;
+    rtcStateSeal();
+    memoryDirty = false;
+
+    bleShutdown();
+    hidBleClearAllBonds();
+
+    u8g2.setContrast(oledContrast);
+    analogWrite(LED_PIN, ledBrightness);
+}
+
+
+// --- bond metadata helpers ---
+
+static bool parseMacString(const String& s, uint8_t* out) {
+    if (s.length() < 17) return false;
+    for (int i = 0; i < 6; i++) {
+        char hex[3] = { s.charAt(i * 3), s.charAt(i * 3 + 1), 0 };
+        out[i] = (uint8_t)strtol(hex, nullptr, 16);
+    }
+    return true;
+}
+
+static int findBondMetaByMac(const uint8_t* mac) {
+    for (uint8_t i = 0; i < bondMetaCount; i++) {
+        if (memcmp(bondMetaList[i].mac, mac, 6) == 0) return i;
+    }
+    return -1;
+}
+
+static uint8_t getBondOSByMac(const uint8_t* mac) {
+    int idx = findBondMetaByMac(mac);
+    return (idx < 0) ? 0 : bondMetaList[idx].os;
 }
 
 static void setBondOSByMac(const uint8_t* mac, uint8_t os) {
@@ -1240,7 +2112,7 @@ static void setBondOSByMac(const uint8_t* mac, uint8_t os) {
         bondMetaList[bondMetaCount].os = os;
         bondMetaCount++;
     }
-    saveSettings();
+    markSettingsDirty(FIELD_BOND_META);
 }
 
 static void removeBondMetaByMac(const uint8_t* mac) {
@@ -1250,7 +2122,7 @@ static void removeBondMetaByMac(const uint8_t* mac) {
         bondMetaList[i] = bondMetaList[i + 1];
     }
     bondMetaCount--;
-    saveSettings();
+    markSettingsDirty(FIELD_BOND_META);
 }
 
 static void applyConnectedPeerOS() {
@@ -1274,6 +2146,7 @@ void btRefreshBondsCache() {
 
 void bleStartAdvertising() {
     hidBleInit(false);
+    if (bleTaskHandle) xTaskNotifyGive(bleTaskHandle);  // start watching the link
     bleMode = BLE_MODE_ADVERTISING;
     bleModeUntil = millis() + BLE_ADVERTISE_WINDOW_MS;
 }
@@ -1281,6 +2154,7 @@ void bleStartAdvertising() {
 
 void bleStartPairing() {
     hidBleInit(true);
+    if (bleTaskHandle) xTaskNotifyGive(bleTaskHandle);
     bleMode = BLE_MODE_PAIRING;
     bleModeUntil = millis() + BLE_PAIRING_WINDOW_MS;
 }
@@ -1387,9 +2261,7 @@ void handleSettingsKey(char key) {
             return;
         }
         if (key == '*') {
-            if (settingsInput.length() > 0) {
-                settingsInput.remove(settingsInput.length() - 1);
-            }
+            settingsInput.removeLast();
             drawMenu();
             return;
         }
@@ -1398,7 +2270,7 @@ void handleSettingsKey(char key) {
                 uint32_t mins = settingsInput.toInt();
                 if (mins == 0) mins = 1; // floor at 1 minute
                 sleepTimeoutMs = mins * 60000UL;
-                saveSettings();
+                markSettingsDirty(FIELD_SLEEP_MS);
             }
             settingsView = SETTINGS_VIEW_LIST;
             settingsInput = "";
@@ -1411,7 +2283,7 @@ void handleSettingsKey(char key) {
     if (settingsView == SETTINGS_VIEW_CONTRAST || settingsView == SETTINGS_VIEW_BRIGHTNESS) {
         uint8_t* val = (settingsView == SETTINGS_VIEW_CONTRAST) ? &oledContrast : &ledBrightness;
         if (key == '=') {
-            saveSettings();
+            markSettingsDirty(settingsView == SETTINGS_VIEW_CONTRAST ? FIELD_CONTRAST : FIELD_LED);
             settingsView = SETTINGS_VIEW_LIST;
             drawMenu();
             return;
@@ -1445,7 +2317,7 @@ void handleSettingsKey(char key) {
         }
         if (key == '5' || key == '=') {
             qbindEditSlot = QBIND_VALID_SLOTS[qbindListIdx];
-            int8_t cur = qbindSlots[qbindEditSlot];
+            int cur = macroFromRef(qbindSlots[qbindEditSlot]);
             qbindPickIdx = (cur < 0) ? 0 : (uint8_t)(cur + 1);
             settingsView = SETTINGS_VIEW_QBIND_PICK;
             drawMenu();
@@ -1455,7 +2327,7 @@ void handleSettingsKey(char key) {
     }
 
     if (settingsView == SETTINGS_VIEW_QBIND_PICK) {
-        int total = MACRO_COUNT + 1;
+        int total = macroCount() + 1;
         if (key == '8') {
             if (qbindPickIdx > 0) qbindPickIdx--;
             drawMenu();
@@ -1467,8 +2339,8 @@ void handleSettingsKey(char key) {
             return;
         }
         if (key == '5' || key == '=') {
-            qbindSlots[qbindEditSlot] = (qbindPickIdx == 0) ? -1 : (int8_t)(qbindPickIdx - 1);
-            saveSettings();
+            qbindSlots[qbindEditSlot] = (qbindPickIdx == 0) ? MACRO_REF_NONE : macroRef(qbindPickIdx - 1);
+            markSettingsDirty(FIELD_QBIND);
             settingsView = SETTINGS_VIEW_QBIND_LIST;
             drawMenu();
             return;
@@ -1609,7 +2481,27 @@ void handleSettingsKey(char key) {
             return;
         }
         if (key == '5' || key == '=') {
-            saveSettings();
+            markSettingsDirty(FIELD_ZOOM);
+            settingsView = SETTINGS_VIEW_LIST;
+            drawMenu();
+            return;
+        }
+        return;
+    }
+
+    if (settingsView == SETTINGS_VIEW_BATCH_SEP) {
+        if (key == '8') {
+            if (batchSeparator > 0) batchSeparator--;
+            drawMenu();
+            return;
+        }
+        if (key == '2') {
+            if (batchSeparator < 1) batchSeparator++;
+            drawMenu();
+            return;
+        }
+        if (key == '5' || key == '=') {
+            markSettingsDirty(FIELD_BATCH_SEP);
             settingsView = SETTINGS_VIEW_LIST;
             drawMenu();
             return;
@@ -1628,30 +2520,70 @@ void handleSettingsKey(char key) {
         return;
     }
 
+    if (settingsView == SETTINGS_VIEW_POWER) {
+        if (key == '8' && powerScroll > 0) powerScroll--;
+        else if (key == '2' && powerScroll + POWER_VIEW_ROWS < ENERGY_ROW_COUNT) powerScroll++;
+        else return;
+        drawMenu();
+        return;
+    }
+
     // SETTINGS_VIEW_FW_INFO and SETTINGS_VIEW_BATTERY: read-only, only C exits
     // (handled above)
 }
 
 
-void drawMenu() {
-    u8g2.clearBuffer();
+static void drawMenuFrame() {
     switch (menuPage) {
         case MENU_PAGE_MACROS:   drawMacroPage();    break;
         case MENU_PAGE_SETTINGS: drawSettingsPage(); break;
+        case MENU_PAGE_HISTORY:  drawHistoryPage();  break;
+        case MENU_PAGE_TAPE:     drawTapePage();     break;
     }
-    u8g2.sendBuffer();
+}
+
+
+void drawMenu() {
+    renderFrame(drawMenuFrame);
+}
+
+
+// "MEAN 1234.5      n42": the selected stat on the left, the count on the right
+static void drawStatsBar() {
+    char count[12];
+    snprintf(count, sizeof(count), "n%lu", (unsigned long)statsCount());
+    char line[22];  // 21 columns of 6x10
+    size_t used = snprintf(line, sizeof(line), "%s ", statsLabel((StatKind)statView));
+    double v;
+    if (statView == STAT_RESET) {
+        strlcpy(line + used, "[*]", sizeof(line) - used);
+    } else if (!statsValue((StatKind)statView, &v)
+               || !fmtDouble(v, line + used, sizeof(line) - 2 - used - strlen(count))) {
+        strlcpy(line + used, "--", sizeof(line) - used);
+    }
+    u8g2.drawStr(0, 10, line);
+    u8g2.drawStr(128 - u8g2.getStrWidth(count), 10, count);
 }
 
 
 void drawTopBar() {
     u8g2.setFont(u8g2_font_6x10_tr);
     
-    if (macro.state == MACRO_AWAITING_INPUT) {
-        u8g2.drawStr(0, 10, macroGetPrompt());
+    if (!exprIsEmpty(&expr)) {
+        char status[22];  // 21 columns of 6x10
+        exprFormat(&expr, status, sizeof(status) - 1);
+        u8g2.drawStr(0, 10, status);
+    }
+    else if (macro.state == MACRO_AWAITING_INPUT && macro.stream) {
+        drawStatsBar();
     }
-    else if (storedValue.length() > 0 && pendingOp) {
-        String status = storedValue + " " + pendingOp;
-        u8g2.drawStr(0, 10, status.c_str());
+    else if (macro.state == MACRO_AWAITING_INPUT) {
+        u8g2.drawStr(0, 10, macroGetPrompt());
+        if (macro.batch) {
+            char count[8];
+            snprintf(count, sizeof(count), "#%u", macro.batchCount);
+            u8g2.drawStr(128 - u8g2.getStrWidth(count), 10, count);
+        }
     }
 }
 
@@ -1688,18 +2620,25 @@ void drawBottomBar() {
         iconX -= ICON_WIDTH;  // blank
     }
     
-    // battery low or blank
+    // battery: warning icon when low, else a level gauge; blank on USB
     iconX -= 2;
+    iconX -= ICON_WIDTH;
     if (lowBattery) {
-        iconX -= ICON_WIDTH;
         u8g2.drawXBM(iconX, iconY, ICON_WIDTH, ICON_HEIGHT, ICON_LOWBATT);
-    } else {
-        iconX -= ICON_WIDTH;  // blank
+    } else if (battGauge >= 0) {
+        u8g2.drawFrame(iconX, iconY + 2, BATT_GAUGE_STEPS + 2, 7);
+        u8g2.drawBox(iconX + BATT_GAUGE_STEPS + 2, iconY + 4, 1, 3);  // terminal
+        u8g2.drawBox(iconX + 1, iconY + 3, battGauge, 5);
+    }
+
+    // memory register in use
+    if (!decIsZero(rtcState.memory)) {
+        u8g2.drawStr(iconX - 7, 64, "M");
     }
     
-    // leftmost: RESULT SENT flash, NUM/NAV in numpad mode, else function name
+    // leftmost: message flash, NUM/NAV in numpad mode, else function name
     if (messageUntil > 0 && millis() < messageUntil) {
-        u8g2.drawStr(0, 64, "RESULT SENT");
+        u8g2.drawStr(0, 64, messageText);
     } else if (numpadMode) {
         u8g2.drawStr(0, 64, numLockOn ? "NUM" : "NAV");
     } else if (functionName.length() > 0) {
@@ -1711,7 +2650,11 @@ void drawBottomBar() {
 void drawMainDisplay() {
     int len = displayValue.length();
     int16_t y;
-    if (len <= 6) {
+    if (displayValue.indexOf('e') >= 0) {
+        // the _tn number fonts have no 'e'
+        u8g2.setFont(u8g2_font_logisoso16_tr);
+        y = 43;
+    } else if (len <= 6) {
         u8g2.setFont(u8g2_font_logisoso32_tn);
         y = 50;
     } else if (len <= 8) {
@@ -1731,12 +2674,15 @@ void drawMainDisplay() {
 }
 
 
-void updateDisplay() {
-    u8g2.clearBuffer();
+static void drawCalculator() {
     drawTopBar();
     drawMainDisplay();
     drawBottomBar();
-    u8g2.sendBuffer();
+}
+
+
+void updateDisplay() {
+    renderFrame(bootOverlayUntil ? drawBootScreen : drawCalculator);
 }
 
 
@@ -1752,34 +2698,73 @@ void clearFunction() {
 }
 
 
-double calculate(double a, double b, char op) {
-    switch (op) {
-        case '+': return a + b;
-        case '-': return a - b;
-        case '*': return a * b;
-        case '/': return b != 0 ? a / b : 0;
-        default: return b;
-    }
+// exact when it fits the display, otherwise rounded to DISPLAY_RESULT_MAX
+// characters; written into the caller's buffer
+void formatResult(Decimal result, char* out, size_t size) {
+    if (size == 0) return;
+    size_t width = size - 1 < DISPLAY_RESULT_MAX ? size - 1 : DISPLAY_RESULT_MAX;
+    fmtDecimal(result, out, width);
 }
 
 
-String formatResult(double result) {
-    String out = String(result, 6);
-    while (out.endsWith("0") && out.indexOf('.') != -1) {
-        out.remove(out.length() - 1);
-    }
-    if (out.endsWith(".")) {
-        out.remove(out.length() - 1);
+static void drawSleeping() {
+    u8g2.setFont(u8g2_font_6x10_tr);
+    u8g2.drawStr(0, 32, "Sleeping...");
+}
+
+
+// snapshot the calculator into RTC memory so the next wake resumes it
+static void saveSession() {
+    RtcSession& s = rtcState.session;
+    s.valid = true;
+    s.newEntry = newEntry;
+    strlcpy(s.displayValue, displayValue.c_str(), sizeof(s.displayValue));
+    s.displayExact = displayExact;
+    s.displayExactValid = displayExactValid;
+    strlcpy(s.functionName, functionName.c_str(), sizeof(s.functionName));
+    s.expr = expr;
+    s.macroRef = MACRO_REF_NONE;
+    if (macro.state == MACRO_AWAITING_INPUT) {
+        s.macroRef = macroRef(macro.index);
+        s.macroParamIndex = macro.paramIndex;
+        memcpy(s.macroParams, macro.params, sizeof(s.macroParams));
+        s.macroBatch = macro.batch;
+        s.macroBatchPinned = macro.batchPinned;
+        s.macroBatchCount = macro.batchCount;
+    }
+    rtcStateSeal();
+}
+
+
+static void restoreSession() {
+    const RtcSession& s = rtcState.session;
+    newEntry = s.newEntry;
+    displayValue = s.displayValue;
+    displayExact = s.displayExact;
+    displayExactValid = s.displayExactValid;
+    functionName = s.functionName;
+    expr = s.expr;
+    int index = macroFromRef(s.macroRef);
+    if (index >= 0) {
+        macroStart(index);
+        memcpy(macro.params, s.macroParams, sizeof(macro.params));
+        macro.paramIndex = s.macroParamIndex < macro.paramCount ? s.macroParamIndex : 0;
+        macro.batch = s.macroBatch;
+        macro.batchPinned = s.macroBatch && s.macroBatchPinned;
+        macro.batchCount = s.macroBatchCount;
     }
-    return out;
 }
 
 
 void goToSleep() {
-    u8g2.clearBuffer();
-    u8g2.setFont(u8g2_font_6x10_tr);
-    u8g2.drawStr(0, 32, "Sleeping...");
-    u8g2.sendBuffer();
+    hidFlush();  // finish typing any queued batch results
+    saveSession();
+    flushMemory();
+    flushSettings();
+    energySleep();
+    saveConfigSnapshot();
+    batteryStop();
+    renderFrame(drawSleeping);
     delay(500);
     bleShutdown();
     u8g2.setPowerSave(1);
@@ -1788,6 +2773,69 @@ void goToSleep() {
 }
 
 
+static void applyIdleStage(IdleStage stage) {
+    bool blank = stage >= IDLE_BLANK;
+    if (blank == displayOn) {
+        u8g2.setPowerSave(blank);
+        displayOn = !blank;
+    }
+    uint8_t dimContrast = oledContrast < IDLE_DIM_CONTRAST ? oledContrast : IDLE_DIM_CONTRAST;
+    u8g2.setContrast(stage == IDLE_AWAKE ? oledContrast : dimContrast);
+    analogWrite(LED_PIN, stage == IDLE_AWAKE ? ledBrightness : stage == IDLE_DIM ? ledBrightness / 4 : 0);
+    PERF_PRINTF("idle: stage %d -> %d after %lu ms\n", idleStage, stage,
+                (unsigned long)(millis() - lastActivity));
+    idleStage = stage;
+}
+
+
+// light sleep stops the USB controller and the BLE radio, so a mounted host,
+// a BLE link or an advertising window keeps us at blank
+static bool idleSleepAllowed() {
+    return numpadMode && !hidUsbMounted() && bleMode == BLE_MODE_OFF;
+}
+
+
+static bool idleKeysHeld() {
+    return matrixKeysDown || digitalRead(WAKE_PIN) == LOW;
+}
+
+
+static void updateIdleLadder() {
+    uint32_t idle = millis() - lastActivity;
+    IdleStage want = IDLE_AWAKE;
+    if (idle >= IDLE_DIM_MS) want = IDLE_DIM;
+    if (numpadMode && idle >= IDLE_BLANK_MS) want = IDLE_BLANK;
+    if (idle >= IDLE_SLEEP_MS && idleSleepAllowed() && !idleKeysHeld()) want = IDLE_SLEEP;
+    if (want != idleStage) applyIdleStage(want);
+}
+
+
+// light sleep until the next timer, in place of loop()'s wait. Every row is
+// driven low so any key pulls its column low and wakes us; the held key is
+// then still down for the scan task's next pass.
+static void idleLightSleep(uint32_t ms) {
+    for (int i = 0; i < 4; i++) digitalWrite(ROW_PINS[i], LOW);
+    for (int i = 0; i < 4; i++) gpio_wakeup_enable((gpio_num_t)COL_PINS[i], GPIO_INTR_LOW_LEVEL);
+    gpio_wakeup_enable((gpio_num_t)WAKE_PIN, GPIO_INTR_LOW_LEVEL);
+    esp_sleep_enable_gpio_wakeup();
+    esp_sleep_enable_timer_wakeup((uint64_t)ms * 1000);
+
+    esp_light_sleep_start();
+
+    bool keyWake = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+    esp_sleep_disable_wakeup_source(ESP_SLEEP_WAKEUP_ALL);
+    for (int i = 0; i < 4; i++) gpio_wakeup_disable((gpio_num_t)COL_PINS[i]);
+    gpio_wakeup_disable((gpio_num_t)WAKE_PIN);
+    // that also cleared the scan task's key interrupts: have it scan and re-arm.
+    // It runs above us on this core, so matrixKeysDown is current on return
+    xSemaphoreGive(keyEvent);
+    if (keyWake) {
+        idleWokeAt = esp_timer_get_time();
+        applyIdleStage(IDLE_BLANK);  // stay up while the key is held
+    }
+}
+
+
 bool waitForEnter() {
     // wait for enter key press (with debounce)
     while (true) {
@@ -1859,45 +2907,60 @@ GuideAction waitForGuideNav(bool canScrollUp, bool canScrollDown) {
 }
 
 
+// guide position, shared with drawGuidePage() for the picture loop
+static const int GUIDE_VISIBLE_LINES = 4;
+static int guidePage = 0;
+static int guideScroll = 0;
+static int guideMaxScroll = 0;
+
+static void drawGuidePage() {
+    int page = guidePage;
+    int scroll = guideScroll;
+    int lineCount = GUIDE_PAGES[page].lineCount;
+
+    u8g2.setFont(u8g2_font_6x10_tr);
+    for (int line = 0; line < GUIDE_VISIBLE_LINES && (scroll + line) < lineCount; line++) {
+        const char* text = GUIDE_PAGES[page].lines[scroll + line];
+        if (strlen(text) > 0) {
+            u8g2.drawStr(0, 12 + (line * 12), text);
+        }
+    }
+
+    // scroll arrows (top-right / above progress dots)
+    if (scroll > 0) {
+        u8g2.drawTriangle(123, 0, 119, 4, 127, 4);
+    }
+    if (scroll < guideMaxScroll) {
+        u8g2.drawTriangle(123, 57, 119, 53, 127, 53);
+    }
+
+    // progress dots at bottom
+    u8g2.setFont(u8g2_font_5x7_tr);
+    int dotsWidth = GUIDE_PAGE_COUNT * 6;
+    int dotsX = (128 - dotsWidth) / 2;
+    for (int i = 0; i < GUIDE_PAGE_COUNT; i++) {
+        if (i == page) {
+            u8g2.drawDisc(dotsX + (i * 6) + 2, 62, 2);
+        } else {
+            u8g2.drawCircle(dotsX + (i * 6) + 2, 62, 2);
+        }
+    }
+}
+
+
 void showGuide() {
-    const int visibleLines = 4;
     int page = 0;
     int scroll = 0;
     while (page < GUIDE_PAGE_COUNT) {
         int lineCount = GUIDE_PAGES[page].lineCount;
-        int maxScroll = lineCount > visibleLines ? lineCount - visibleLines : 0;
+        int maxScroll = lineCount > GUIDE_VISIBLE_LINES ? lineCount - GUIDE_VISIBLE_LINES : 0;
         if (scroll > maxScroll) scroll = maxScroll;
         if (scroll < 0) scroll = 0;
 
-        u8g2.clearBuffer();
-        u8g2.setFont(u8g2_font_6x10_tr);
-        for (int line = 0; line < visibleLines && (scroll + line) < lineCount; line++) {
-            const char* text = GUIDE_PAGES[page].lines[scroll + line];
-            if (strlen(text) > 0) {
-                u8g2.drawStr(0, 12 + (line * 12), text);
-            }
-        }
-
-        // scroll arrows (top-right / above progress dots)
-        if (scroll > 0) {
-            u8g2.drawTriangle(123, 0, 119, 4, 127, 4);
-        }
-        if (scroll < maxScroll) {
-            u8g2.drawTriangle(123, 57, 119, 53, 127, 53);
-        }
-
-        // progress dots at bottom
-        u8g2.setFont(u8g2_font_5x7_tr);
-        int dotsWidth = GUIDE_PAGE_COUNT * 6;
-        int dotsX = (128 - dotsWidth) / 2;
-        for (int i = 0; i < GUIDE_PAGE_COUNT; i++) {
-            if (i == page) {
-                u8g2.drawDisc(dotsX + (i * 6) + 2, 62, 2);
-            } else {
-                u8g2.drawCircle(dotsX + (i * 6) + 2, 62, 2);
-            }
-        }
-        u8g2.sendBuffer();
+        guidePage = page;
+        guideScroll = scroll;
+        guideMaxScroll = maxScroll;
+        renderFrame(drawGuidePage);
         lastActivity = millis();
 
         GuideAction action = waitForGuideNav(scroll > 0, scroll < maxScroll);
@@ -1925,30 +2988,12 @@ void showGuide() {
 }
 
 
-void initBattery() {
-    // ~0-3.1V usable range; the 2:1 divider keeps the pin <= ~2.1V at 4.2V batt
-    analogSetPinAttenuation(BATT_PIN, ADC_11db);
-    // prime the ADC and let the RC filter settle before the first real read
-    for (int i = 0; i < 8; i++) analogReadMilliVolts(BATT_PIN);
-}
-
-
-static int readBatteryPinMv() {
-    const int N = 32;
-    uint32_t sum = 0;
-    for (int i = 0; i < N; i++) sum += analogReadMilliVolts(BATT_PIN);
-    return (int)(sum / N);
-}
-
-
-static int readBatteryMv() {
-    return (int)(readBatteryPinMv() * BATT_DIVIDER);
-}
-
-
 void updateBattery() {
-    int mv = readBatteryMv();
+    int mv = batteryMv();
+    int percent = batteryPercent();
     bool prev = lowBattery;
+    int8_t prevGauge = battGauge;
+    battGauge = percent < 0 ? -1 : (percent * BATT_GAUGE_STEPS + 50) / 100;
     if (mv < BATT_VALID_MIN_MV || mv > BATT_VALID_MAX_MV) {
         // on USB (or no live cell): never show a low-battery warning
         lowBattery = false;
@@ -1958,107 +3003,1080 @@ void updateBattery() {
         lowBattery = false;
     }
     // redraw only in the normal view; the menu doesn't show the battery icon
-    if (lowBattery != prev && macro.state != MACRO_MENU) updateDisplay();
+    if ((lowBattery != prev || battGauge != prevGauge) && macro.state != MACRO_MENU) {
+        updateDisplay();
+    }
+}
+
+
+// --- console commands ---
+
+// render draw() into a 128x64 frame in U8g2's tile layout (8 vertical
+// pixels per byte), whichever buffer mode the build uses
+static void captureFrame(void (*draw)(), uint8_t* tiles) {
+    captureBuf = tiles;
+    renderFrame(draw);
+    captureBuf = nullptr;
+}
+
+
+// one row of a captured frame as PBM wants it: horizontal bytes, MSB =
+// leftmost pixel (U8g2 tiles have bit 0 = top pixel)
+static void frameRowToPbm(const uint8_t* tiles, int y, uint8_t* row) {
+    memset(row, 0, 128 / 8);
+    for (int x = 0; x < 128; x++) {
+        if (tiles[(y >> 3) * 128 + x] & (1 << (y & 7))) {
+            row[x >> 3] |= 0x80 >> (x & 7);
+        }
+    }
+}
+
+
+// Every view the render bench walks (and the host renderer, test/host),
+// with the menu state each one needs; the state is restored afterwards.
+typedef void (*ViewVisitor)(const char* name, void (*draw)());
+
+static void forEachView(ViewVisitor visit) {
+    uint8_t savedPage = menuPage;
+    SettingsView savedView = settingsView;
+    char name[16];
+
+    visit("calc", drawCalculator);
+    visit("boot", drawBootScreen);
+    menuPage = MENU_PAGE_MACROS;
+    visit("macros", drawMenuFrame);
+    menuPage = MENU_PAGE_HISTORY;
+    visit("history", drawMenuFrame);
+    menuPage = MENU_PAGE_TAPE;
+    visit("tape", drawMenuFrame);
+    menuPage = MENU_PAGE_SETTINGS;
+    for (int v = SETTINGS_VIEW_LIST; v < SETTINGS_VIEW_COUNT; v++) {
+        settingsView = (SettingsView)v;
+        snprintf(name, sizeof(name), "settings%d", v);
+        visit(name, drawMenuFrame);
+    }
+    for (int page = 0; page < GUIDE_PAGE_COUNT; page++) {
+        guidePage = page;
+        guideScroll = 0;
+        guideMaxScroll = 0;
+        snprintf(name, sizeof(name), "guide%d", page);
+        visit(name, drawGuidePage);
+    }
+
+    menuPage = savedPage;
+    settingsView = savedView;
+}
+
+
+// "shot": re-render the current screen and send it as a binary PBM (P4).
+static void cmdScreenshot(const char* args) {
+    (void)args;
+    if (!lastFrameDraw) {
+        Serial.println("ERR nothing drawn yet");
+        return;
+    }
+    uint8_t* tiles = (uint8_t*)malloc(128 * 64 / 8);
+    if (!tiles) {
+        Serial.println("ERR out of memory");
+        return;
+    }
+    captureFrame(lastFrameDraw, tiles);
+    Serial.print("P4\n128 64\n");
+    uint8_t row[128 / 8];
+    for (int y = 0; y < 64; y++) {
+        frameRowToPbm(tiles, y, row);
+        Serial.write(row, sizeof(row));
+    }
+    free(tiles);
+}
+
+
+static uint32_t benchFrames(void (*draw)()) {
+    const int N = 20;
+    uint32_t t0 = micros();
+    for (int i = 0; i < N; i++) renderFrame(draw);
+    return (micros() - t0) / N;
+}
+
+
+static void benchView(const char* name, void (*draw)()) {
+    Serial.printf("%s: %lu us/frame\n", name, (unsigned long)benchFrames(draw));
+}
+
+
+// "render": average render+flush time of every view, then restore the screen
+static void cmdRenderBench(const char* args) {
+    (void)args;
+    void (*resume)() = lastFrameDraw;
+    frameLogMuted = true;
+    forEachView(benchView);
+    frameLogMuted = false;
+    if (resume) renderFrame(resume);
+}
+
+
+// "decbench": ns per +, *, / for the decimal engine vs the old double path
+static void cmdDecimalBench(const char* args) {
+    (void)args;
+    const int N = 10000;
+    volatile double da = 1234.5678, db = 7.25;
+    volatile double dr = 0;
+    Decimal xa, xb, xr = {0};
+    decParse("1234.5678", &xa);
+    decParse("7.25", &xb);
+    volatile int64_t sink = 0;
+
+    uint32_t t0 = micros();
+    for (int i = 0; i < N; i++) dr = da + db;
+    uint32_t dAdd = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) dr = da * db;
+    uint32_t dMul = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) dr = da / db;
+    uint32_t dDiv = micros() - t0;
+
+    t0 = micros();
+    for (int i = 0; i < N; i++) { decAdd(xa, xb, &xr); sink = xr.raw; }
+    uint32_t xAdd = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) { decMul(xa, xb, &xr); sink = xr.raw; }
+    uint32_t xMul = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) { decDiv(xa, xb, &xr); sink = xr.raw; }
+    uint32_t xDiv = micros() - t0;
+    (void)dr;
+    (void)sink;
+
+    // us per N ops * 1000 / N = ns per op; N = 10000 so that's us / 10
+    Serial.printf("double:  add %lu  mul %lu  div %lu ns/op\n",
+                  (unsigned long)(dAdd / 10), (unsigned long)(dMul / 10), (unsigned long)(dDiv / 10));
+    Serial.printf("decimal: add %lu  mul %lu  div %lu ns/op\n",
+                  (unsigned long)(xAdd / 10), (unsigned long)(xMul / 10), (unsigned long)(xDiv / 10));
+}
+
+
+// "fmtbench [n]": us per call for fmtDouble vs snprintf("%.17g"), then a
+// round-trip check of n random doubles (default 10000) through strtod
+static void cmdFormatBench(const char* args) {
+    const int N = 1000;
+    static const double SAMPLES[] = {0.1, 1.0 / 3, 1234.5678, 2.5e-7, 6.02214076e23, 19.99 * 1.0725};
+    const int SAMPLE_COUNT = sizeof(SAMPLES) / sizeof(SAMPLES[0]);
+    char buf[32];
+
+    uint32_t t0 = micros();
+    for (int i = 0; i < N; i++) fmtDouble(SAMPLES[i % SAMPLE_COUNT], buf, 24);
+    uint32_t tShort = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) snprintf(buf, sizeof(buf), "%.17g", SAMPLES[i % SAMPLE_COUNT]);
+    uint32_t tPrintf = micros() - t0;
+    t0 = micros();
+    for (int i = 0; i < N; i++) fmtDouble(SAMPLES[i % SAMPLE_COUNT], buf, DISPLAY_RESULT_MAX);
+    uint32_t tFit = micros() - t0;
+
+    // us per N calls * 1000 / N = ns per call; N = 1000 so that's the us figure
+    Serial.printf("fmtDouble %lu ns  fit-13 %lu ns  snprintf %%.17g %lu ns\n",
+                  (unsigned long)tShort, (unsigned long)tFit, (unsigned long)tPrintf);
+
+    long count = atol(args);
+    if (count <= 0) count = 10000;
+    long failures = 0;
+    for (long i = 0; i < count; i++) {
+        uint64_t bits = ((uint64_t)esp_random() << 32) | esp_random();
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        if (v != v || v - v != 0) continue;  // NaN, inf
+        fmtDouble(v, buf, 24);
+        double back = strtod(buf, nullptr);
+        if (memcmp(&back, &v, sizeof(v)) != 0) {
+            if (failures++ < 5) Serial.printf("MISMATCH %s\n", buf);
+        }
+    }
+    Serial.printf("round-trip: %ld values, %ld failures\n", count, failures);
+}
+
+
+// copy the next space-separated word of *args into out; false if none
+static bool nextWord(const char** args, char* out, size_t size) {
+    const char* p = *args;
+    while (*p == ' ') p++;
+    size_t n = 0;
+    while (*p && *p != ' ') {
+        if (n + 1 < size) out[n++] = *p;
+        p++;
+    }
+    out[n] = 0;
+    *args = p;
+    return n > 0;
+}
+
+
+// macro names are upper case; accept any case at the console
+static void upcase(char* s) {
+    for (; *s; s++) *s = toupper(*s);
+}
+
+
+// user formulas sit after the built-ins, so editing them can shift indices:
+// drop a half-entered one rather than let it run the wrong bytecode
+static void cancelUserMacro() {
+    if (macro.state == MACRO_AWAITING_INPUT && macro.index >= MACRO_COUNT) {
+        macroCancel();
+        functionName = "";
+    }
+    menuIndex = 0;
+}
+
+
+// "fdef NAME FORMULA": compile a user macro over p0..p3 and store it in NVS,
+// e.g. "fdef FRT p0*(1+p1/100)+p2"
+static void cmdFormulaDefine(const char* args) {
+    Formula f;
+    memset(&f, 0, sizeof(f));
+    char name[16];
+    if (!nextWord(&args, name, sizeof(name)) || !*args) {
+        Serial.println("ERR usage: fdef NAME FORMULA");
+        return;
+    }
+    if (strlen(name) > FORMULA_NAME_MAX) {
+        Serial.printf("ERR name is at most %d characters\n", FORMULA_NAME_MAX);
+        return;
+    }
+    upcase(name);
+    for (uint8_t i = 0; i < MACRO_COUNT; i++) {
+        if (strcmp(MACROS[i].name, name) == 0) {
+            Serial.printf("ERR %s is a built-in macro\n", name);
+            return;
+        }
+    }
+    strcpy(f.name, name);
+
+    uint32_t t0 = micros();
+    const char* err = formulaCompile(args, &f);
+    uint32_t compileUs = micros() - t0;
+    if (err) {
+        Serial.printf("ERR %s\n", err);
+        return;
+    }
+    if (!formulaStore(&f)) {
+        Serial.printf("ERR all %d formula slots are used (fdel one)\n", FORMULA_MAX);
+        return;
+    }
+    formulaSaveAll();
+    cancelUserMacro();
+    Serial.printf("OK %s: %u params, %u B bytecode, stack %u, compiled in %lu us\n",
+                  f.name, f.paramCount, f.codeLen, f.stackDepth, (unsigned long)compileUs);
+}
+
+
+// "flist": stored user formulas
+static void cmdFormulaList(const char* args) {
+    (void)args;
+    for (uint8_t i = 0; i < formulaCount; i++) {
+        Serial.printf("%-5s %u params, %u B bytecode\n",
+                      formulas[i].name, formulas[i].paramCount, formulas[i].codeLen);
+    }
+    Serial.printf("%u of %d slots used\n", formulaCount, FORMULA_MAX);
+}
+
+
+// "fdel NAME": remove a user formula; quick binds pointing at it are cleared
+static void cmdFormulaDelete(const char* args) {
+    char name[16];
+    nextWord(&args, name, sizeof(name));
+    upcase(name);
+    int pos = formulaRemove(name);
+    if (pos < 0) {
+        Serial.printf("ERR no formula '%s'\n", name);
+        return;
+    }
+    // later formulas moved down a slot
+    int8_t removed = MACRO_REF_FORMULA + pos;
+    for (int i = 0; i < 10; i++) {
+        if (qbindSlots[i] == removed) qbindSlots[i] = MACRO_REF_NONE;
+        else if (qbindSlots[i] > removed) qbindSlots[i]--;
+    }
+    markSettingsDirty(FIELD_QBIND);
+    formulaSaveAll();
+    cancelUserMacro();
+    Serial.printf("OK %s removed\n", name);
+}
+
+
+// "frun NAME p0 p1 ...": evaluate once and time 1000 runs
+static void cmdFormulaRun(const char* args) {
+    char word[24];
+    nextWord(&args, word, sizeof(word));
+    upcase(word);
+    int i = formulaFind(word);
+    if (i < 0) {
+        Serial.printf("ERR no formula '%s'\n", word);
+        return;
+    }
+    const Formula* f = &formulas[i];
+    Decimal params[FORMULA_PARAM_MAX] = {};
+    for (uint8_t n = 0; n < f->paramCount; n++) {
+        if (!nextWord(&args, word, sizeof(word)) || !decParse(word, &params[n])) {
+            Serial.printf("ERR %s needs %u numbers\n", f->name, f->paramCount);
+            return;
+        }
+    }
+
+    const int N = 1000;
+    Decimal result = {0};
+    bool ok = true;
+    uint32_t t0 = micros();
+    for (int n = 0; n < N; n++) ok = formulaRun(f, params, &result);
+    uint32_t elapsed = micros() - t0;
+
+    char buf[24];
+    decFormat(result, buf, sizeof(buf));
+    // us per N runs * 1000 / N = ns per run; N = 1000 so that's the us figure
+    Serial.printf("%s = %s (%lu ns/eval, %u B bytecode)\n", f->name, ok ? buf : "OVERFLOW",
+                  (unsigned long)elapsed, f->codeLen);
+}
+
+
+// "tvmbench [n]": solve n random loans (default 1000) for the rate, checking
+// each answer against the rate that built it; reports time and iterations
+static void cmdTvmBench(const char* args) {
+    long count = atol(args);
+    if (count <= 0) count = 1000;
+    long failures = 0, fallbacks = 0;
+    uint32_t totalUs = 0, maxUs = 0, totalIter = 0, maxIter = 0;
+    for (long k = 0; k < count; k++) {
+        // 1..480 periods, 0..3% per period, one in four with a balloon payment
+        double n = 1 + esp_random() % 480;
+        double rate = (esp_random() % 30000) / 1e6;
+        double pv = 100 + esp_random() % 1000000;
+        double fv = esp_random() % 4 == 0 ? -pv * (esp_random() % 50) / 100 : 0;
+        double pmt, solved;
+        TvmStats st;
+        if (!tvmPmt(n, rate, pv, fv, &pmt)) continue;
+        if (!tvmRate(n, pv, pmt, fv, &solved, &st) || fabs(solved - rate) > 1e-8) {
+            if (failures++ < 5) {
+                Serial.printf("FAIL n=%g i=%g pv=%g fv=%g\n", n, rate, pv, fv);
+            }
+        }
+        totalUs += st.micros;
+        totalIter += st.iterations;
+        if (st.micros > maxUs) maxUs = st.micros;
+        if (st.iterations > maxIter) maxIter = st.iterations;
+        if (st.bisected) fallbacks++;
+    }
+    Serial.printf("rate: %ld solves, %lu us avg, %lu us max, %lu.%02lu iter avg, %lu max\n",
+                  count, (unsigned long)(totalUs / count), (unsigned long)maxUs,
+                  (unsigned long)(totalIter / count), (unsigned long)(totalIter * 100 / count % 100),
+                  (unsigned long)maxIter);
+    Serial.printf("rate: %ld needed the bisection fallback, %ld failures\n", fallbacks, failures);
+}
+
+
+// "irr cf0 cf1 ...": internal rate of return of up to 16 cash flows
+static void cmdIrr(const char* args) {
+    double flows[TVM_FLOW_MAX];
+    uint8_t count = 0;
+    char word[24];
+    while (count < TVM_FLOW_MAX && nextWord(&args, word, sizeof(word))) {
+        flows[count++] = strtod(word, nullptr);
+    }
+    double rate;
+    TvmStats st;
+    if (!tvmIrr(flows, count, &rate, &st)) {
+        Serial.println(count < 2 ? "usage: irr CF0 CF1 [CF2 ...]" : "irr: no solution");
+        return;
+    }
+    char buf[32];
+    fmtDouble(rate * 100, buf, 24);
+    Serial.printf("irr = %s%% (%u iterations%s, %lu us)\n", buf, st.iterations,
+                  st.bisected ? ", bisection" : "", (unsigned long)st.micros);
+}
+
+// "tape": the whole tape as CSV in one streamed transfer; "tape clear" empties it
+static void cmdTape(const char* args) {
+    char word[8];
+    if (nextWord(&args, word, sizeof(word)) && strcmp(word, "clear") == 0) {
+        tapeClear();
+        Serial.println("tape cleared");
+        return;
+    }
+#ifdef PERF_LOG
+    uint32_t t0 = micros();
+    size_t bytes = tapeExportCsv(Serial);
+    uint32_t elapsed = micros() - t0;
+    PERF_PRINTF("tape: %lu lines, %lu B in %lu us (%lu KB/s)\n", (unsigned long)tapeCount(),
+                (unsigned long)bytes, (unsigned long)elapsed,
+                (unsigned long)(elapsed ? (uint64_t)bytes * 1000 / elapsed : 0));
+#else
+    tapeExportCsv(Serial);
+#endif
+}
+
+
+// "nvs": NVS keys written since boot, and which settings are still pending
+static void cmdNvsStats(const char* args) {
+    (void)args;
+    Serial.printf("nvs: %lu keys written this session, pending 0x%02x\n",
+                  (unsigned long)nvsWrites, settingsDirty);
+}
+
+
+// Config transfer frames (tools/ttcfg.py). The image is the settings blob as
+// stored in NVS (its own version and CRC included), then the formula count and
+// that many Formula records. A reply has the request's cmd | CONFIG_REPLY and
+// starts with a ConfigStatus byte; a GET reply carries the image after it.
+#define CONFIG_FRAME_GET 0x01
+#define CONFIG_FRAME_PUT 0x02
+#define CONFIG_REPLY 0x80
+#define CONFIG_IMAGE_MAX (sizeof(SettingsBlob) + 1 + sizeof(formulas))
+static_assert(1 + CONFIG_IMAGE_MAX <= CONSOLE_FRAME_MAX, "config image outgrew a console frame");
+
+enum ConfigStatus : uint8_t {
+    CONFIG_OK,
+    CONFIG_BAD_COMMAND,
+    CONFIG_BAD_SETTINGS,  // blob too long, newer version, CRC mismatch, or out of range
+    CONFIG_BAD_FORMULAS
+};
+
+
+// what the settings menu itself could have produced, with `formulaTotal`
+// formulas to bind to; a CRC only proves the image wasn't damaged in transit
+static bool settingsInRange(const SettingsBlob* b, uint8_t formulaTotal) {
+    if (b->sleepMs < SLEEP_TIMEOUT_MIN_MS || b->sleepMs > SLEEP_TIMEOUT_MAX_MS) return false;
+    if (b->zoomMod > 1 || b->batchSep > 1) return false;
+    int8_t binds[10];
+    memcpy(binds, b->qbind, sizeof(binds));
+    if (b->header.version < 3) migrateQbindIndices(binds);
+    for (int8_t ref : binds) {
+        bool builtIn = ref >= 0 && ref < MACRO_COUNT;
+        bool formula = ref >= MACRO_REF_FORMULA && ref - MACRO_REF_FORMULA < formulaTotal;
+        if (ref != MACRO_REF_NONE && !builtIn && !formula) return false;
+    }
+    return true;
+}
+
+
+static uint16_t exportConfig(uint8_t* out) {
+    SettingsBlob b;
+    packSettings(&b);
+    memcpy(out, &b, sizeof(b));
+    out[sizeof(b)] = formulaCount;
+    memcpy(out + sizeof(b) + 1, formulas, formulaCount * sizeof(Formula));
+    return sizeof(b) + 1 + formulaCount * sizeof(Formula);
+}
+
+
+// all or nothing: nothing is applied unless the whole image checks out
+static ConfigStatus importConfig(const uint8_t* data, uint16_t length) {
+    SettingsHeader header;
+    if (length < sizeof(header)) return CONFIG_BAD_SETTINGS;
+    memcpy(&header, data, sizeof(header));
+    size_t blobBytes = sizeof(header) + header.length;
+    if (blobBytes > sizeof(SettingsBlob) || blobBytes >= length) return CONFIG_BAD_SETTINGS;
+    SettingsBlob b;
+    packSettings(&b);  // an older, shorter blob keeps the current tail
+    memcpy(&b, data, blobBytes);
+    if (!settingsBlobValid(&b, blobBytes)) return CONFIG_BAD_SETTINGS;
+
+    uint8_t count = data[blobBytes];
+    if (count > FORMULA_MAX || length != blobBytes + 1 + count * sizeof(Formula)) {
+        return CONFIG_BAD_FORMULAS;
+    }
+    Formula incoming[FORMULA_MAX];
+    memcpy(incoming, data + blobBytes + 1, count * sizeof(Formula));
+    for (uint8_t i = 0; i < count; i++) {
+        Formula& f = incoming[i];
+        f.name[FORMULA_NAME_MAX] = 0;
+        if (!f.name[0] || f.codeLen > FORMULA_CODE_MAX
+            || f.paramCount == 0 || f.paramCount > FORMULA_PARAM_MAX) {
+            return CONFIG_BAD_FORMULAS;
+        }
+    }
+    if (!settingsInRange(&b, count)) return CONFIG_BAD_SETTINGS;
+
+    unpackSettings(&b);
+    memcpy(formulas, incoming, sizeof(incoming));
+    formulaCount = count;
+    settingsDirty = FIELD_ALL;
+    flushSettings();
+    formulaSaveAll();
+    cancelUserMacro();
+    u8g2.setContrast(oledContrast);
+    analogWrite(LED_PIN, ledBrightness);
+    return CONFIG_OK;
+}
+
+
+static void handleConfigFrame(uint8_t cmd, const uint8_t* payload, uint16_t length) {
+    uint8_t reply[1 + CONFIG_IMAGE_MAX];
+    uint16_t replyLen = 1;
+#ifdef PERF_LOG
+    uint32_t t0 = micros();
+#endif
+    if (cmd == CONFIG_FRAME_GET) {
+        reply[0] = CONFIG_OK;
+        replyLen += exportConfig(reply + 1);
+    } else if (cmd == CONFIG_FRAME_PUT) {
+        reply[0] = importConfig(payload, length);
+        if (reply[0] == CONFIG_OK) {
+            lastActivity = millis();
+            updateDisplay();
+        }
+    } else {
+        reply[0] = CONFIG_BAD_COMMAND;
+    }
+    consoleSendFrame(cmd | CONFIG_REPLY, reply, replyLen);
+    PERF_PRINTF("cfg: frame 0x%02x, %u B in, %u B out, status %u, %lu us\n", cmd, length,
+                replyLen, reply[0], (unsigned long)(micros() - t0));
+}
+
+
+// "pm": time in each clock state and per max-clock reason since boot;
+// "pm max" pins the max clock (for measuring each state's current with a
+// meter), "pm auto" lets it scale again; "pm poll" brings back the fixed
+// 20 ms loop and "pm event" the timer-driven one, to compare wakeups/s
+static void cmdPower(const char* args) {
+    char word[8];
+    if (nextWord(&args, word, sizeof(word))) {
+        static bool pinned = false;
+        if (strcmp(word, "poll") == 0 || strcmp(word, "event") == 0) {
+            loopPolling = word[0] == 'p';
+            loopWakeups = 0;
+            timerCancel(TIMER_WAKEUP_STATS);  // start a fresh window
+        } else if (pinned != (strcmp(word, "max") == 0)) {
+            if (!pinned) powerBoost(POWER_CONSOLE);
+            else powerRelax(POWER_CONSOLE);
+            pinned = !pinned;
+        }
+    }
+    if (powerScalingActive()) {
+        Serial.printf("pm: scaling %d-%lu MHz, automatic light sleep %s, now %s\n", POWER_MIN_MHZ,
+                      (unsigned long)powerMaxMhz(),
+                      powerLightSleepActive() ? "on" : "off (no tickless idle)",
+                      powerStateName(powerState()));
+    } else {
+        // the stock Arduino core libraries are built without CONFIG_PM_ENABLE
+        Serial.printf("pm: FIXED CLOCK at %lu MHz (no CONFIG_PM_ENABLE in this build): "
+                      "locks do nothing, states below are only what the clock would be\n",
+                      (unsigned long)getCpuFrequencyMhz());
+    }
+    for (uint8_t s = 0; s < POWER_STATE_COUNT; s++) {
+        Serial.printf("  %-7s %10lu ms\n", powerStateName((PowerState)s),
+                      (unsigned long)(powerStateMicros((PowerState)s) / 1000));
+    }
+    for (uint8_t r = 0; r < POWER_REASON_COUNT; r++) {
+        Serial.printf("  %-7s %10lu ms held, %lu times\n", powerReasonName((PowerReason)r),
+                      (unsigned long)(powerReasonMicros((PowerReason)r) / 1000),
+                      (unsigned long)powerReasonCount((PowerReason)r));
+    }
+    Serial.printf("idle: stage %d, light-sleep wake to key dispatch: last %lu us, max %lu us\n",
+                  idleStage, (unsigned long)idleWakeLatencyUs, (unsigned long)idleWakeLatencyMaxUs);
+    Serial.printf("loop: %s, %lu.%lu wakeups/s over the last %us\n", loopPolling ? "polling" : "event-driven",
+                  (unsigned long)(loopWakeupRate / 10), (unsigned long)(loopWakeupRate % 10),
+                  WAKEUP_WINDOW_MS / 1000);
+}
+
+
+// "tasks": each task's core, priority, busy share since the previous
+// "tasks" (or boot) and the stack it has never touched; starts a new window
+static void cmdTasks(const char* args) {
+    (void)args;
+    Serial.printf("%-5s core prio   load  stack free\n", "task");
+    for (uint8_t t = 0; t < TASK_COUNT; t++) {
+        uint16_t load = taskLoadPermille((AppTask)t);
+        Serial.printf("%-5s %4u %4u %3u.%u%% %7lu B\n", taskName((AppTask)t), taskCore((AppTask)t),
+                      taskPriority((AppTask)t), load / 10, load % 10,
+                      (unsigned long)taskStackFree((AppTask)t));
+    }
+    Serial.printf("queues: %u ui events, hid %s\n", (unsigned)uxQueueMessagesWaiting(uiEvents),
+                  hidBusy() ? "busy" : "idle");
+    taskLoadReset();
+}
+
+
+// "energy": residency and estimated charge per state; "energy reset" starts
+// the ledger over; "energy ua ROW UA" sets a row's current coefficient
+static void cmdEnergy(const char* args) {
+    char word[8];
+    if (nextWord(&args, word, sizeof(word))) {
+        if (strcmp(word, "reset") == 0) {
+            energyReset();
+        } else if (strcmp(word, "ua") == 0) {
+            char row[4], ua[8];
+            if (!nextWord(&args, row, sizeof(row)) || !nextWord(&args, ua, sizeof(ua))
+                || atoi(row) < 0 || atoi(row) >= ENERGY_ROW_COUNT) {
+                Serial.printf("ERR usage: energy ua <0-%d> <uA>\n", ENERGY_ROW_COUNT - 1);
+                return;
+            }
+            long value = atol(ua);
+            energyUa[atoi(row)] = value < 0 ? 0 : value > 65535 ? 65535 : value;
+            markSettingsDirty(FIELD_ENERGY);
+        }
+    }
+    char dur[10], mah[12];
+    for (uint8_t r = 0; r < ENERGY_ROW_COUNT; r++) {
+        formatDuration(energyRowMs((EnergyRow)r), dur, sizeof(dur));
+        formatMah(energyRowUah((EnergyRow)r), mah, sizeof(mah));
+        Serial.printf("%u %-8s %10lu ms (%s) x %5u uA = %s mAh\n", r, energyRowName((EnergyRow)r),
+                      (unsigned long)energyRowMs((EnergyRow)r), dur, energyUa[r], mah);
+    }
+    formatMah(energyTotalUah(), mah, sizeof(mah));
+    Serial.printf("total %s mAh\n", mah);
+}
+
+
+static const ConsoleCommand CONSOLE_COMMANDS[] = {
+    {"shot",     cmdScreenshot},
+    {"render",   cmdRenderBench},
+    {"decbench", cmdDecimalBench},
+    {"fmtbench", cmdFormatBench},
+    {"fdef",     cmdFormulaDefine},
+    {"flist",    cmdFormulaList},
+    {"fdel",     cmdFormulaDelete},
+    {"frun",     cmdFormulaRun},
+    {"tvmbench", cmdTvmBench},
+    {"irr",      cmdIrr},
+    {"tape",     cmdTape},
+    {"nvs",      cmdNvsStats},
+    {"pm",       cmdPower},
+    {"energy",   cmdEnergy},
+    {"tasks",    cmdTasks},
+};
+static const uint8_t CONSOLE_COMMAND_COUNT = sizeof(CONSOLE_COMMANDS) / sizeof(CONSOLE_COMMANDS[0]);
+
+
+// Background half of the staged boot: ADC priming, which is slow and not
+// needed to take the first keypress. USB HID stays lazy (numpad toggle or
+// first send), since USB.begin() re-enumerates and drops the console.
+static void bootTask(void* arg) {
+    (void)arg;
+    batteryBegin();
+    bootBackgroundDone = true;
+    vTaskDelete(nullptr);
+}
+
+
+static void bootTaskStart() {
+    xTaskCreate(bootTask, "boot", 4096, nullptr, 1, nullptr);
+}
+
+
+// Foreground half: runs from loop() once bootTask has finished. BLE comes up
+// here, on the UI task that owns the BLE state machine, after the first frame.
+static void bootFinish() {
+    bootFinished = true;
+    if (hidBleGetBondCount() > 0) {
+        bleStartAdvertising();
+    }
+    updateBattery();  // initial read on wake/boot
+    PERF_PRINTF("boot: background init done at %lu ms\n", (unsigned long)millis());
 }
 
 
 void setup() {
+    consoleBegin();
+    consoleSetFrameHandler(handleConfigFrame);
+    powerBegin();
     pinMode(WAKE_PIN, INPUT_PULLUP);
     pinMode(LED_PIN, OUTPUT);
     initMatrix();
-    initBattery();
+    initKeyEvents();
     Wire.begin(SDA_PIN, SCL_PIN);
-    u8g2.begin();
+#ifdef PERF_LOG
+    u8x8_t* u8x8 = u8g2.getU8x8();
+    i2cByteCb = u8x8->byte_cb;
+    u8x8->byte_cb = countI2cBytes;
+#endif
+
+    // a key wake from our own deep sleep finds the resolved config, formulas
+    // and session still in RTC memory: no NVS, and no display clear, since
+    // the first frame overwrites the whole panel anyway
+    esp_sleep_wakeup_cause_t wakeup = esp_sleep_get_wakeup_cause();
+    bool rtcValid = rtcStateInit();
+    energyDefaults();  // before any blob that predates the coefficients is unpacked
+    energyWake();
+    bool fastResume = rtcValid
+        && (wakeup == ESP_SLEEP_WAKEUP_EXT0 || wakeup == ESP_SLEEP_WAKEUP_EXT1)
+        && restoreConfigSnapshot();
+    if (fastResume) {
+        u8g2.initDisplay();  // init sequence only; the panel stays off until drawn
+    } else {
+        u8g2.begin();
+    }
+    PERF_PRINTF("display: %u B frame buffer\n",
+                (unsigned)(u8g2.getBufferTileHeight() * u8g2.getBufferTileWidth() * 8));
     u8g2.setFlipMode(1); // rotate display 180 degrees
 
+    if (fastResume) {
+        u8g2.setContrast(oledContrast);
+        analogWrite(LED_PIN, ledBrightness);
+        if (rtcState.session.valid) restoreSession();
+        bootTaskStart();
+        startAppTasks();
+        lastActivity = millis();
+        updateDisplay();
+        u8g2.setPowerSave(0);
+        PERF_PRINTF("wake: interactive at %lu ms (rtc snapshot)\n", (unsigned long)millis());
+        return;
+    }
+
     Preferences prefs;
     prefs.begin("t2", false);
 
-    sleepTimeoutMs = prefs.getULong("sleepMs", DEFAULT_SLEEP_TIMEOUT);
-    oledContrast   = prefs.getUChar("contrast", 255);
-    ledBrightness  = prefs.getUChar("ledBri",   255);
-    zoomModifier   = prefs.getUChar("zoomMod",  0);
-    if (prefs.isKey("qbind")) {
-        prefs.getBytes("qbind", qbindSlots, sizeof(qbindSlots));
-    }
-    bondMetaCount = prefs.getUChar("bmCnt", 0);
-    if (bondMetaCount > BT_BOND_MAX) bondMetaCount = 0;
-    if (bondMetaCount > 0 && prefs.isKey("bmData")) {
-        prefs.getBytes("bmData", bondMetaList, bondMetaCount * sizeof(BondMeta));
+#ifdef PERF_LOG
+    uint32_t cfgStart = micros();
+#endif
+    if (!loadSettings(prefs) && !migrateLegacySettings(prefs)) {
+        defaultSettings();  // first boot, or the blob was corrupt
     }
+    PERF_PRINTF("cfg: settings loaded in %lu us\n", (unsigned long)(micros() - cfgStart));
     u8g2.setContrast(oledContrast);
     analogWrite(LED_PIN, ledBrightness);
+    formulaLoadAll();  // before the session, which may be inside a user macro
 
-    esp_sleep_wakeup_cause_t wakeup = esp_sleep_get_wakeup_cause();
+    if (!rtcValid) {
+        rtcState.memory.raw = prefs.getLong64("mem", 0);
+        rtcStateSeal();
+    } else if (wakeup != ESP_SLEEP_WAKEUP_UNDEFINED && rtcState.session.valid) {
+        restoreSession();
+    }
     if (wakeup == ESP_SLEEP_WAKEUP_UNDEFINED) {
-        bool firstBoot = prefs.getBool("guided", false) == false;
+        bool firstBoot = !guided;
 #ifdef FORCE_FIRST_BOOT
         firstBoot = true;
 #endif
 
-        showBootScreen();
         if (firstBoot) {
             welcomeText();
             showGuide();
-            prefs.putBool("guided", true);
+            guided = true;
+            writeSettings(prefs);
+        } else {
+            showBootOverlay();
         }
     }
     prefs.end();
 
-    if (hidBleGetBondCount() > 0) {
-        bleStartAdvertising();
-    }
+    bootTaskStart();
+    startAppTasks();
 
     lastActivity = millis();
-    updateBattery();  // initial read on wake/boot
     updateDisplay();
+    PERF_PRINTF("boot: first frame at %lu ms\n", (unsigned long)millis());
+    if (wakeup != ESP_SLEEP_WAKEUP_UNDEFINED) {
+        PERF_PRINTF("wake: interactive at %lu ms (nvs)\n", (unsigned long)millis());
+    }
 }
 
 
-void loop() {
-    char key = scanMatrix();
-    if (!key) key = scanWakeKey();
+// --- event-driven loop ---
+
+// one-shot: the interrupt is level-triggered so a key already held when a
+// wait arms it still fires, and masks itself until the next wait
+static void IRAM_ATTR keyEventIsr(void* arg) {
+    gpio_ll_intr_disable(&GPIO, (gpio_num_t)(uintptr_t)arg);
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(keyEvent, &woken);
+    if (woken) portYIELD_FROM_ISR();
+}
 
-    if (key && key != lastKey) {
-        handleKey(key);
+
+void initKeyEvents() {
+    keyEvent = xSemaphoreCreateBinary();
+    for (int i = 0; i <= 4; i++) {
+        uint8_t pin = i < 4 ? COL_PINS[i] : WAKE_PIN;
+        attachInterruptArg(pin, keyEventIsr, (void*)(uintptr_t)pin, ONLOW);
+        gpio_intr_disable((gpio_num_t)pin);
     }
-    lastKey = key;
+}
 
-    // clear the RESULT SENT message once its window expires
-    if (messageUntil > 0 && millis() >= messageUntil) {
-        messageUntil = 0;
-        updateDisplay();
+
+// block for up to `ms` or until a key goes down. The rows are driven low so
+// any matrix key pulls its column low; with automatic light sleep the same
+// pins are armed as GPIO wake sources.
+static void waitForKey(uint32_t ms) {
+    while (xSemaphoreTake(keyEvent, 0) == pdTRUE) {}  // left over from the last wait
+    bool wake = powerLightSleepActive();
+    for (int i = 0; i < 4; i++) digitalWrite(ROW_PINS[i], LOW);
+    for (int i = 0; i <= 4; i++) {
+        gpio_num_t pin = (gpio_num_t)(i < 4 ? COL_PINS[i] : WAKE_PIN);
+        gpio_set_intr_type(pin, GPIO_INTR_LOW_LEVEL);
+        if (wake) gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+        gpio_intr_enable(pin);
     }
+    if (wake) esp_sleep_enable_gpio_wakeup();
 
-    blePoll();
+    xSemaphoreTake(keyEvent, pdMS_TO_TICKS(ms));
 
-    // refresh BT status countdown live while the BT page is open
-    static uint32_t lastBtTick = 0;
-    if (macro.state == MACRO_MENU && menuPage == MENU_PAGE_SETTINGS
-        && settingsView == SETTINGS_VIEW_BT
-        && millis() - lastBtTick > 1000) {
-        drawMenu();
-        lastBtTick = millis();
+    for (int i = 0; i <= 4; i++) {
+        gpio_num_t pin = (gpio_num_t)(i < 4 ? COL_PINS[i] : WAKE_PIN);
+        gpio_intr_disable(pin);
+        if (wake) gpio_wakeup_disable(pin);
     }
+    for (int i = 0; i < 4; i++) digitalWrite(ROW_PINS[i], HIGH);
+}
+
 
-    // periodic battery check (initial read happens on wake in setup)
-    static uint32_t lastBattCheck = 0;
-    if (millis() - lastBattCheck > BATT_SAMPLE_INTERVAL) {
-        updateBattery();
-        lastBattCheck = millis();
+// the deadlines loop() used to compare millis() against on every pass
+static void onTimer(uint8_t id) {
+    uint32_t now = millis();
+    switch (id) {
+        case TIMER_BOOT_OVERLAY:
+            if (bootOverlayUntil && (int32_t)(now - bootOverlayUntil) >= 0) {
+                bootOverlayUntil = 0;
+                updateDisplay();
+            }
+            break;
+        case TIMER_MESSAGE:
+            // clear the bottom-bar message once its window expires
+            if (messageUntil > 0 && now >= messageUntil) {
+                messageUntil = 0;
+                updateDisplay();
+            }
+            break;
+        case TIMER_BLE:
+            blePoll();  // advertising window or deferred connection-parameter deadline
+            break;
+        case TIMER_MEMORY_FLUSH:
+            if (memoryDirty && now - memoryChangedAt > MEMORY_FLUSH_MS) flushMemory();
+            break;
+        case TIMER_SETTINGS_FLUSH:
+            if (settingsDirty && now - settingsChangedAt > SETTINGS_FLUSH_MS) flushSettings();
+            break;
+        case TIMER_VIEW_REFRESH:
+            drawMenu();
+            break;
+        case TIMER_BATTERY: {
+            // the first call starts an ADC burst, the second drains it
+            uint32_t again = batteryPoll();
+            if (again) {
+                timerArm(TIMER_BATTERY, now + again);
+                break;
+            }
+            updateBattery();
+            break;
+        }
+        case TIMER_IDLE:
+            updateIdleLadder();
+            if (!numpadMode && now - lastActivity > sleepTimeoutMs) goToSleep();
+            break;
+        case TIMER_WAKEUP_STATS:
+            loopWakeupRate = (uint32_t)((uint64_t)loopWakeups * 10000 / WAKEUP_WINDOW_MS);
+            PERF_PRINTF("loop: %lu.%lu wakeups/s (%s)\n", (unsigned long)(loopWakeupRate / 10),
+                        (unsigned long)(loopWakeupRate % 10), loopPolling ? "polling" : "event");
+            loopWakeups = 0;
+            break;
     }
+}
 
-    // live-refresh the battery readout while its page is open
-    static uint32_t lastBattView = 0;
-    if (macro.state == MACRO_MENU && menuPage == MENU_PAGE_SETTINGS
-        && settingsView == SETTINGS_VIEW_BATTERY
-        && millis() - lastBattView > 1000) {
-        drawMenu();
-        lastBattView = millis();
+
+static void armOrCancel(uint8_t id, bool armed, uint32_t due) {
+    if (armed) timerArm(id, due);
+    else timerCancel(id);
+}
+
+
+// re-derive every deadline from the state this pass left behind; the flush
+// checks are strict (>), hence the +1
+static void syncTimers() {
+    uint32_t now = millis();
+    armOrCancel(TIMER_BOOT_OVERLAY, bootOverlayUntil != 0, bootOverlayUntil);
+    armOrCancel(TIMER_MESSAGE, messageUntil != 0, messageUntil);
+    armOrCancel(TIMER_MEMORY_FLUSH, memoryDirty, memoryChangedAt + MEMORY_FLUSH_MS + 1);
+    armOrCancel(TIMER_SETTINGS_FLUSH, settingsDirty, settingsChangedAt + SETTINGS_FLUSH_MS + 1);
+
+    // periodic ones keep their phase while they stay wanted
+    bool liveView = macro.state == MACRO_MENU && menuPage == MENU_PAGE_SETTINGS
+                    && (settingsView == SETTINGS_VIEW_BT || settingsView == SETTINGS_VIEW_BATTERY
+                        || settingsView == SETTINGS_VIEW_POWER);
+    if (!liveView) timerCancel(TIMER_VIEW_REFRESH);
+    else if (!timerArmed(TIMER_VIEW_REFRESH)) timerArm(TIMER_VIEW_REFRESH, now + 1000);
+    // link changes arrive from the BLE task; only blePoll()'s own deadlines are timed
+    uint32_t bleDue = bleConnParamsAt != 0 ? bleConnParamsAt : bleModeUntil;
+    armOrCancel(TIMER_BLE, bleMode != BLE_MODE_OFF && bleDue != 0, bleDue);
+    if (!timerArmed(TIMER_BATTERY)) timerArm(TIMER_BATTERY, now + BATT_SAMPLE_INTERVAL);
+    if (!timerArmed(TIMER_WAKEUP_STATS)) timerArm(TIMER_WAKEUP_STATS, now + WAKEUP_WINDOW_MS);
+
+    // the next idle-ladder step, or deep sleep outside numpad mode
+    uint32_t step = 0;
+    if (idleStage < IDLE_DIM) step = IDLE_DIM_MS;
+    else if (numpadMode && idleStage < IDLE_BLANK) step = IDLE_BLANK_MS;
+    else if (idleStage < IDLE_SLEEP && idleSleepAllowed()) step = IDLE_SLEEP_MS;
+    if (!numpadMode && (step == 0 || sleepTimeoutMs + 1 < step)) step = sleepTimeoutMs + 1;
+    uint32_t due = lastActivity + step;
+    // a held key is what's blocking light sleep; the release may fire nothing
+    if (step == IDLE_SLEEP_MS && (int32_t)(due - now) <= 0) due = now + IDLE_HELD_RECHECK_MS;
+    armOrCancel(TIMER_IDLE, step != 0, due);
+}
+
+
+// --- tasks ---
+
+// Scans the matrix and posts each new key to the UI. It runs above the UI
+// on the same core, so whenever the UI task runs this one is parked in a
+// wait: vTaskDelay() with the rows high, or waitForKey() with them low.
+static void scanTask(void* arg) {
+    (void)arg;
+    char last = 0;
+    for (;;) {
+        taskBusyBegin(TASK_SCAN);
+        char key = scanMatrix();
+        if (!key) key = scanWakeKey();
+        if (key && key != last) {
+            UiEvent ev = {UI_EVENT_KEY, key};
+            xQueueSend(uiEvents, &ev, portMAX_DELAY);
+        }
+        last = key;
+        bool held = matrixKeysDown || digitalRead(WAKE_PIN) == LOW;
+        taskBusyEnd(TASK_SCAN);
+        // chords, release-fired keys and the FN tap need the held keys watched
+        if (held || loopPolling) vTaskDelay(pdMS_TO_TICKS(LOOP_SCAN_MS));
+        else waitForKey(LOOP_WAIT_MAX_MS);
     }
+}
 
-    if (!numpadMode && millis() - lastActivity > sleepTimeoutMs) {
-        goToSleep();
+
+// Watches the BLE link while the stack is up and tells the UI when it comes
+// or goes; sleeps on a notification while BLE is off.
+static void bleTask(void* arg) {
+    (void)arg;
+    bool linked = false;
+    for (;;) {
+        if (!hidBleIsActive()) {
+            linked = false;
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        taskBusyBegin(TASK_BLE);
+        bool conn = hidBleIsConnected();
+        if (conn != linked) {
+            linked = conn;
+            UiEvent ev = {UI_EVENT_BLE_LINK, 0};
+            xQueueSend(uiEvents, &ev, portMAX_DELAY);
+        }
+        taskBusyEnd(TASK_BLE);
+        vTaskDelay(pdMS_TO_TICKS(BLE_POLL_MS));
     }
-    delay(20);
-}
\ No newline at end of file
+}
+
+
+// one wake per wait is enough: the pass that takes it reads everything pending
+static volatile bool consoleWakePosted = false;
+
+static void consoleWake() {
+    if (consoleWakePosted) return;
+    consoleWakePosted = true;
+    UiEvent ev = {UI_EVENT_CONSOLE, 0};
+    if (xQueueSend(uiEvents, &ev, 0) != pdTRUE) consoleWakePosted = false;
+}
+
+
+// after setup's own matrix reads (welcome, guide) are done
+static void startAppTasks() {
+    uiEvents = xQueueCreate(UI_EVENT_QUEUE, sizeof(UiEvent));
+    taskRegister(TASK_UI, xTaskGetCurrentTaskHandle());
+    consoleOnInput(consoleWake);
+    hidBegin();
+    scanTaskHandle = taskStart(TASK_SCAN, scanTask);
+    bleTaskHandle = taskStart(TASK_BLE, bleTask);
+}
+
+
+// the settings guide reads the matrix directly; the scan task is parked in
+// a wait whenever this (lower-priority) task runs, so suspending it is safe
+void scanPause() {
+    if (!scanTaskHandle) return;
+    vTaskSuspend(scanTaskHandle);
+    for (int i = 0; i < 4; i++) digitalWrite(ROW_PINS[i], HIGH);
+}
+
+
+void scanResume() {
+    if (!scanTaskHandle) return;
+    xSemaphoreGive(keyEvent);  // rescan and re-arm from a clean state
+    vTaskResume(scanTaskHandle);
+}
+
+
+static void dispatchKey(char key) {
+    static bool firstKeySeen = false;
+    if (!firstKeySeen) {
+        firstKeySeen = true;
+        PERF_PRINTF("boot: first key at %lu ms\n", (unsigned long)millis());
+    }
+    if (bootOverlayUntil) {
+        bootOverlayUntil = 0;  // first keypress dismisses the logo and still counts
+    }
+#ifdef PERF_LOG
+    uint32_t allocs0 = heapAllocCount;
+#endif
+    if (idleWokeAt) {
+        // measured to the hand-off: in numpad mode the press is the first
+        // thing handleKey() queues for the HID task; the panel only comes
+        // back after that
+        idleWakeLatencyUs = esp_timer_get_time() - idleWokeAt;
+        if (idleWakeLatencyUs > idleWakeLatencyMaxUs) idleWakeLatencyMaxUs = idleWakeLatencyUs;
+        PERF_PRINTF("idle: key 0x%02x dispatched %lu us after light-sleep wake\n", (uint8_t)key,
+                    (unsigned long)idleWakeLatencyUs);
+        idleWokeAt = 0;
+    }
+    powerBoost(POWER_KEYS);
+    handleKey(key);
+    powerRelax(POWER_KEYS);
+    PERF_PRINTF("key 0x%02x: %lu heap allocs\n", (uint8_t)key,
+                (unsigned long)(heapAllocCount - allocs0));
+}
+
+
+// between passes: block until the next timer or an event from the scan or
+// BLE task, or light-sleep at the bottom of the idle ladder
+static void loopWait() {
+    uint32_t now = millis();
+    if (idleStage == IDLE_SLEEP && !hidBusy() && !batterySampling()
+        && uxQueueMessagesWaiting(uiEvents) == 0) {
+        idleLightSleep(timerWaitMs(now, LOOP_WAIT_MAX_MS));
+        return;
+    }
+    // received bytes post a wake, but a frame split across USB packets must
+    // not stall for CONSOLE_FRAME_TIMEOUT_MS on a missed one, so the wait is
+    // capped while a host is on the bus (HID may never have been started)
+    uint32_t cap = consoleHostPresent() ? CONSOLE_POLL_MS : LOOP_WAIT_MAX_MS;
+    if (loopPolling || !bootFinished) cap = LOOP_SCAN_MS;
+    uint32_t wait = timerWaitMs(now, cap);
+    UiEvent ev;
+    if (wait > 0) xQueuePeek(uiEvents, &ev, pdMS_TO_TICKS(wait));
+}
+
+
+// the UI task: keys, display, timers and the console
+void loop() {
+    taskBusyBegin(TASK_UI);
+    loopWakeups++;
+    // book the time since the last pass (mostly the wait) under the state it was spent in
+    energyTick((displayOn ? ENERGY_FLAG_DISPLAY : 0)
+               | (bleMode == BLE_MODE_ADVERTISING || bleMode == BLE_MODE_PAIRING ? ENERGY_FLAG_BLE_ADV : 0)
+               | (bleMode == BLE_MODE_CONNECTED ? ENERGY_FLAG_BLE_CONN : 0));
+
+    consolePoll(CONSOLE_COMMANDS, CONSOLE_COMMAND_COUNT);
+
+    UiEvent ev;
+    while (xQueueReceive(uiEvents, &ev, 0) == pdTRUE) {
+        if (ev.type == UI_EVENT_KEY) dispatchKey(ev.key);
+        else if (ev.type == UI_EVENT_BLE_LINK) blePoll();
+        else if (ev.type == UI_EVENT_CONSOLE) consoleWakePosted = false;
+    }
+    // a wake that produced no key yet (FN chord, release-fired key) isn't timed
+    if (idleWokeAt && esp_timer_get_time() - idleWokeAt > 50000) idleWokeAt = 0;
+    updateIdleLadder();
+
+    if (!bootFinished && bootBackgroundDone) {
+        bootFinish();
+    }
+    powerSetUsbMounted(hidUsbMounted());
+
+    int expired;
+    while ((expired = timerPopExpired(millis())) >= 0) onTimer(expired);
+    syncTimers();
+    taskBusyEnd(TASK_UI);
+    loopWait();
+}
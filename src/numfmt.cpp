@@ -0,0 +1,384 @@
+#include "numfmt.h"
+
+// Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly and
+// Accurately with Integers", PLDI 2010): scale the double's neighbourhood by a
+// cached power of ten held as a 64-bit fixed-point value, then emit digits
+// until the result is inside the rounding interval. Pure 64-bit integer work,
+// no heap, no bignums; always round-trips, and is shortest in >99.9% of cases.
+
+struct DiyFp {
+    uint64_t f;
+    int e;
+};
+
+#define DP_SIGNIFICAND_BITS 52
+#define DP_HIDDEN_BIT 0x0010000000000000ULL
+#define DP_SIGNIFICAND_MASK 0x000FFFFFFFFFFFFFULL
+#define DP_EXPONENT_BIAS (0x3FF + DP_SIGNIFICAND_BITS)
+
+#define FIXED_MAX_ZEROS 4  // 0.0001234 stays fixed; 0.00001234 goes to 1.234e-5
+
+// normalized 10^k for k = -348, -340, ..., 340
+static const uint64_t CACHED_POWERS_F[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL
+};
+static const int16_t CACHED_POWERS_E[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980,
+    -954, -927, -901, -874, -847, -821, -794, -768, -741, -715,
+    -688, -661, -635, -608, -582, -555, -529, -502, -475, -449,
+    -422, -396, -369, -343, -316, -289, -263, -236, -210, -183,
+    -157, -130, -103, -77, -50, -24, 3, 30, 56, 83,
+    109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614,
+    641, 667, 694, 720, 747, 774, 800, 827, 853, 880,
+    907, 933, 960, 986, 1013, 1039, 1066
+};
+
+static const uint32_t POW10[] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+
+static DiyFp diyFromDouble(double d) {
+    uint64_t bits;
+    memcpy(&bits, &d, sizeof(bits));
+    int biased = (int)((bits >> DP_SIGNIFICAND_BITS) & 0x7FF);
+    uint64_t significand = bits & DP_SIGNIFICAND_MASK;
+    if (biased != 0) return DiyFp{significand + DP_HIDDEN_BIT, biased - DP_EXPONENT_BIAS};
+    return DiyFp{significand, 1 - DP_EXPONENT_BIAS};
+}
+
+
+static DiyFp diyMul(DiyFp x, DiyFp y) {
+    uint64_t a = x.f >> 32, b = (uint32_t)x.f;
+    uint64_t c = y.f >> 32, d = (uint32_t)y.f;
+    uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+    uint64_t tmp = (bd >> 32) + (uint32_t)ad + (uint32_t)bc;
+    tmp += 1U << 31;  // round
+    return DiyFp{ac + (ad >> 32) + (bc >> 32) + (tmp >> 32), x.e + y.e + 64};
+}
+
+
+static DiyFp diyNormalize(DiyFp v) {
+    while (!(v.f & (1ULL << 63))) {
+        v.f <<= 1;
+        v.e--;
+    }
+    return v;
+}
+
+
+// the boundaries halfway to the neighbouring doubles, sharing plus's exponent
+static void diyBoundaries(DiyFp v, DiyFp* minus, DiyFp* plus) {
+    DiyFp pl = {(v.f << 1) + 1, v.e - 1};
+    while (!(pl.f & (DP_HIDDEN_BIT << 1))) {
+        pl.f <<= 1;
+        pl.e--;
+    }
+    pl.f <<= 64 - DP_SIGNIFICAND_BITS - 2;
+    pl.e -= 64 - DP_SIGNIFICAND_BITS - 2;
+    // the gap below a power of two is half the gap above it
+    DiyFp mi = (v.f == DP_HIDDEN_BIT) ? DiyFp{(v.f << 2) - 1, v.e - 2}
+                                      : DiyFp{(v.f << 1) - 1, v.e - 1};
+    mi.f <<= mi.e - pl.e;
+    mi.e = pl.e;
+    *minus = mi;
+    *plus = pl;
+}
+
+
+// cached power c = 10^-k such that e + c.e lands in [-60, -32]
+static DiyFp cachedPower(int e, int* k) {
+    double dk = (-61 - e) * 0.30102999566398114 + 347;  // log10(2)
+    int ik = (int)dk;
+    if (dk - ik > 0.0) ik++;
+    unsigned index = (unsigned)((ik >> 3) + 1);
+    *k = -(-348 + (int)index * 8);
+    return DiyFp{CACHED_POWERS_F[index], CACHED_POWERS_E[index]};
+}
+
+
+static void grisuRound(char* buf, int len, uint64_t delta, uint64_t rest,
+                       uint64_t tenKappa, uint64_t wpw) {
+    while (rest < wpw && delta - rest >= tenKappa &&
+           (rest + tenKappa < wpw || wpw - rest > rest + tenKappa - wpw)) {
+        buf[len - 1]--;
+        rest += tenKappa;
+    }
+}
+
+
+static int countDigits32(uint32_t n) {
+    int d = 1;
+    while (d < 10 && n >= POW10[d]) d++;
+    return d;
+}
+
+
+static void digitGen(DiyFp w, DiyFp mp, uint64_t delta, char* buf, int* len, int* k) {
+    DiyFp one = {1ULL << -mp.e, mp.e};
+    uint64_t wpw = mp.f - w.f;
+    uint32_t p1 = (uint32_t)(mp.f >> -one.e);
+    uint64_t p2 = mp.f & (one.f - 1);
+    int kappa = countDigits32(p1);
+    *len = 0;
+
+    // integer part
+    while (kappa > 0) {
+        uint32_t d = p1 / POW10[kappa - 1];
+        p1 %= POW10[kappa - 1];
+        if (d || *len) buf[(*len)++] = '0' + d;
+        kappa--;
+        uint64_t rest = ((uint64_t)p1 << -one.e) + p2;
+        if (rest <= delta) {
+            *k += kappa;
+            grisuRound(buf, *len, delta, rest, (uint64_t)POW10[kappa] << -one.e, wpw);
+            return;
+        }
+    }
+
+    // fractional part
+    for (;;) {
+        p2 *= 10;
+        delta *= 10;
+        char d = (char)(p2 >> -one.e);
+        if (d || *len) buf[(*len)++] = '0' + d;
+        p2 &= one.f - 1;
+        kappa--;
+        if (p2 < delta) {
+            *k += kappa;
+            int index = -kappa;
+            grisuRound(buf, *len, delta, p2, one.f, wpw * (index < 10 ? POW10[index] : 0));
+            return;
+        }
+    }
+}
+
+
+// v > 0: digits in buf (at most 17), value = 0.buf * 10^point
+static void grisu2(double v, char* buf, int* len, int* point) {
+    DiyFp dv = diyFromDouble(v);
+    DiyFp minus, plus;
+    diyBoundaries(dv, &minus, &plus);
+    int k;
+    DiyFp c = cachedPower(plus.e, &k);
+    DiyFp w = diyMul(diyNormalize(dv), c);
+    DiyFp wp = diyMul(plus, c);
+    DiyFp wm = diyMul(minus, c);
+    wm.f++;
+    wp.f--;
+    digitGen(w, wp, wp.f - wm.f, buf, len, &k);
+    *point = *len + k;
+}
+
+
+// round the digit string to `keep` digits (half up), trimming trailing zeros;
+// a carry out of the first digit bumps the decimal point
+static void roundDigits(char* d, int* len, int* point, int keep) {
+    if (keep >= *len) return;
+    bool up = d[keep] >= '5';
+    *len = keep;
+    if (up) {
+        int i = keep - 1;
+        while (i >= 0 && d[i] == '9') i--;
+        if (i < 0) {
+            d[0] = '1';
+            *len = 1;
+            (*point)++;
+            return;
+        }
+        d[i]++;
+        *len = i + 1;
+    }
+    while (*len > 1 && d[*len - 1] == '0') (*len)--;
+}
+
+
+static int fixedLength(bool negative, int len, int point) {
+    if (point <= 0) return negative + 2 - point + len;  // "0." zeros digits
+    return negative + (len > point ? len + 1 : point);
+}
+
+
+static int exponentLength(bool negative, int len, int exp) {
+    int n = negative + len + (len > 1) + 1 + (exp < 0);
+    int mag = exp < 0 ? -exp : exp;
+    do {
+        n++;
+        mag /= 10;
+    } while (mag);
+    return n;
+}
+
+
+static size_t writeFixed(bool negative, const char* d, int len, int point, char* out) {
+    char* p = out;
+    if (negative) *p++ = '-';
+    if (point <= 0) {
+        *p++ = '0';
+        *p++ = '.';
+        for (int i = 0; i < -point; i++) *p++ = '0';
+        for (int i = 0; i < len; i++) *p++ = d[i];
+    } else {
+        for (int i = 0; i < point; i++) *p++ = i < len ? d[i] : '0';
+        if (len > point) {
+            *p++ = '.';
+            for (int i = point; i < len; i++) *p++ = d[i];
+        }
+    }
+    *p = 0;
+    return p - out;
+}
+
+
+static size_t writeExponent(bool negative, const char* d, int len, int exp, char* out) {
+    char* p = out;
+    if (negative) *p++ = '-';
+    *p++ = d[0];
+    if (len > 1) {
+        *p++ = '.';
+        for (int i = 1; i < len; i++) *p++ = d[i];
+    }
+    *p++ = 'e';
+    if (exp < 0) {
+        *p++ = '-';
+        exp = -exp;
+    }
+    char tmp[4];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + exp % 10;
+        exp /= 10;
+    } while (exp);
+    while (n) *p++ = tmp[--n];
+    *p = 0;
+    return p - out;
+}
+
+
+// lay out 0.d * 10^point in at most `width` characters
+static size_t layout(bool negative, char* d, int len, int point, char* out, size_t width) {
+    int w = (int)width;
+    if (fixedLength(negative, len, point) <= w) return writeFixed(negative, d, len, point, out);
+
+    // fixed notation with fewer fractional digits, if the integer part fits
+    bool intFits = point > 0 && negative + point <= w;
+    bool zerosOk = point <= 0 && -point < FIXED_MAX_ZEROS;
+    if (intFits || zerosOk) {
+        char r[20];
+        int rlen = len, rpoint = point;
+        memcpy(r, d, len);
+        int frac = w - negative - (point > 0 ? point : 1) - 1;  // digits after '.'
+        int keep = point + (frac > 0 ? frac : 0);
+        if (keep >= 1) {
+            roundDigits(r, &rlen, &rpoint, keep);
+            if (fixedLength(negative, rlen, rpoint) <= w) {
+                return writeFixed(negative, r, rlen, rpoint, out);
+            }
+        }
+    }
+
+    // exponent notation, dropping significant digits until it fits
+    int keep = len;
+    for (;;) {
+        while (keep > 1 && exponentLength(negative, keep, point - 1) > w) keep--;
+        int rlen = len, rpoint = point;
+        roundDigits(d, &rlen, &rpoint, keep);
+        if (exponentLength(negative, rlen, rpoint - 1) <= w) {
+            return writeExponent(negative, d, rlen, rpoint - 1, out);
+        }
+        if (keep == 1) break;  // a carry grew the exponent; try one digit fewer
+        keep--;
+    }
+    if (width) out[0] = 0;
+    return 0;
+}
+
+
+static size_t writeWord(const char* s, char* out, size_t width) {
+    size_t len = strlen(s);
+    if (len > width) {
+        if (width) out[0] = 0;
+        return 0;
+    }
+    memcpy(out, s, len + 1);
+    return len;
+}
+
+
+size_t fmtDouble(double v, char* out, size_t width) {
+    if (v != v) return writeWord("nan", out, width);
+    if (v == 0) return writeWord("0", out, width);
+    bool negative = v < 0;
+    if (negative) v = -v;
+    if (v > 1.7976931348623157e308) return writeWord(negative ? "-inf" : "inf", out, width);
+
+    char digits[20];
+    int len, point;
+    grisu2(v, digits, &len, &point);
+    return layout(negative, digits, len, point, out, width);
+}
+
+
+size_t fmtDecimal(Decimal v, char* out, size_t width, DecRound mode) {
+    char buf[24];
+    size_t len = decFormat(v, buf, sizeof(buf));
+    if (len > width) {
+        // round fractional digits away, keeping the integer part whole
+        const char* dot = strchr(buf, '.');
+        size_t intLen = dot ? (size_t)(dot - buf) : len;
+        Decimal r;
+        if (intLen <= width) {
+            uint8_t frac = width > intLen + 1 ? width - intLen - 1 : 0;
+            // rounding up can only overflow at the very end of the range
+            if (!decRoundTo(v, frac, &r, mode)) decRoundTo(v, frac, &r, DEC_ROUND_DOWN);
+            len = decFormat(r, buf, sizeof(buf));
+        }
+    }
+    if (len <= width) {
+        memcpy(out, buf, len + 1);
+        return len;
+    }
+
+    // integer part alone is too wide: exact digits in exponent notation
+    uint64_t mag = v.raw < 0 ? (uint64_t)0 - (uint64_t)v.raw : (uint64_t)v.raw;
+    char digits[20];
+    int n = 0;
+    char tmp[20];
+    do {
+        tmp[n++] = '0' + mag % 10;
+        mag /= 10;
+    } while (mag);
+    for (int i = 0; i < n; i++) digits[i] = tmp[n - 1 - i];
+    int point = n - DEC_FRAC_DIGITS;
+    while (n > 1 && digits[n - 1] == '0') n--;
+    return layout(v.raw < 0, digits, n, point, out, width);
+}
@@ -0,0 +1,162 @@
+#include "power.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "perf.h"
+
+static const char* const REASON_NAMES[POWER_REASON_COUNT] = {"keys", "render", "hid", "console"};
+static const char* const STATE_NAMES[POWER_STATE_COUNT] = {"active", "usb", "idle"};
+
+static esp_pm_lock_handle_t reasonLocks[POWER_REASON_COUNT];
+static esp_pm_lock_handle_t usbLock = nullptr;
+static bool scaling = false;
+static bool lightSleep = false;
+static uint32_t maxMhz = 0;
+
+// the HID task boosts from core 0 while the UI task boosts from core 1; each
+// reason has one owner, but the shared count and residency need the lock
+static portMUX_TYPE powerMux = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t depth[POWER_REASON_COUNT];
+static uint8_t boosted = 0;  // reasons with depth > 0
+static bool usbMounted = false;
+static uint64_t reasonSince[POWER_REASON_COUNT];
+static uint32_t reasonCount[POWER_REASON_COUNT];
+static uint64_t reasonUs[POWER_REASON_COUNT];
+
+static PowerState state = POWER_STATE_IDLE;
+static uint64_t stateSince = 0;  // esp_timer time; micros() would wrap in 71 min
+static uint64_t stateUs[POWER_STATE_COUNT];
+
+
+void powerBegin() {
+    esp_pm_config_esp32s3_t config = {};
+    config.max_freq_mhz = getCpuFrequencyMhz();
+    config.min_freq_mhz = POWER_MIN_MHZ;
+    config.light_sleep_enable = true;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK) {
+        // light sleep needs tickless idle in the IDF build; scaling alone may still work
+        config.light_sleep_enable = false;
+        err = esp_pm_configure(&config);
+    } else {
+        lightSleep = true;
+    }
+    scaling = err == ESP_OK;
+    for (uint8_t r = 0; scaling && r < POWER_REASON_COUNT; r++) {
+        if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, REASON_NAMES[r], &reasonLocks[r]) != ESP_OK) {
+            reasonLocks[r] = nullptr;
+        }
+    }
+    if (scaling && esp_pm_lock_create(ESP_PM_APB_FREQ_MAX, 0, "usb", &usbLock) != ESP_OK) {
+        usbLock = nullptr;
+    }
+    stateSince = esp_timer_get_time();
+    maxMhz = config.max_freq_mhz;
+    PERF_PRINTF("pm: %s, %d-%d MHz, light sleep %s\n",
+                scaling ? "scaling" : "fixed clock (no CONFIG_PM_ENABLE)",
+                POWER_MIN_MHZ, config.max_freq_mhz, lightSleep ? "on" : "off");
+}
+
+
+static PowerState currentState() {
+    if (boosted) return POWER_STATE_ACTIVE;
+    return usbMounted ? POWER_STATE_USB : POWER_STATE_IDLE;
+}
+
+
+// close the running residency interval if the state just changed
+static void account() {
+    PowerState next = currentState();
+    if (next == state) return;
+    uint64_t now = esp_timer_get_time();
+    stateUs[state] += now - stateSince;
+    stateSince = now;
+    state = next;
+}
+
+
+void powerBoost(PowerReason reason) {
+    if (depth[reason]++ > 0) return;
+    if (reasonLocks[reason]) esp_pm_lock_acquire(reasonLocks[reason]);
+    reasonSince[reason] = esp_timer_get_time();
+    reasonCount[reason]++;
+    taskENTER_CRITICAL(&powerMux);
+    boosted++;
+    account();
+    taskEXIT_CRITICAL(&powerMux);
+}
+
+
+void powerRelax(PowerReason reason) {
+    if (depth[reason] == 0 || --depth[reason] > 0) return;
+    reasonUs[reason] += esp_timer_get_time() - reasonSince[reason];
+    if (reasonLocks[reason]) esp_pm_lock_release(reasonLocks[reason]);
+    taskENTER_CRITICAL(&powerMux);
+    boosted--;
+    account();
+    taskEXIT_CRITICAL(&powerMux);
+}
+
+
+void powerSetUsbMounted(bool mounted) {
+    if (mounted == usbMounted) return;
+    usbMounted = mounted;
+    if (usbLock) {
+        if (mounted) esp_pm_lock_acquire(usbLock);
+        else esp_pm_lock_release(usbLock);
+    }
+    taskENTER_CRITICAL(&powerMux);
+    account();
+    taskEXIT_CRITICAL(&powerMux);
+}
+
+
+bool powerScalingActive() {
+    return scaling;
+}
+
+
+bool powerLightSleepActive() {
+    return lightSleep;
+}
+
+
+uint32_t powerMaxMhz() {
+    return maxMhz;
+}
+
+
+PowerState powerState() {
+    return state;
+}
+
+
+const char* powerReasonName(PowerReason reason) {
+    return reason < POWER_REASON_COUNT ? REASON_NAMES[reason] : "";
+}
+
+
+const char* powerStateName(PowerState s) {
+    return s < POWER_STATE_COUNT ? STATE_NAMES[s] : "";
+}
+
+
+uint32_t powerReasonCount(PowerReason reason) {
+    return reasonCount[reason];
+}
+
+
+uint64_t powerReasonMicros(PowerReason reason) {
+    uint64_t us = reasonUs[reason];
+    if (depth[reason] > 0) us += esp_timer_get_time() - reasonSince[reason];
+    return us;
+}
+
+
+uint64_t powerStateMicros(PowerState s) {
+    taskENTER_CRITICAL(&powerMux);
+    uint64_t us = stateUs[s];
+    if (s == state) us += esp_timer_get_time() - stateSince;
+    taskEXIT_CRITICAL(&powerMux);
+    return us;
+}
@@ -0,0 +1,39 @@
+#include "rtc_state.h"
+#include "esp_rom_crc.h"
+
+RTC_DATA_ATTR RtcState rtcState;
+
+
+static uint32_t rtcStateCrc() {
+    return esp_rom_crc32_le(0, (const uint8_t*)&rtcState, offsetof(RtcState, crc));
+}
+
+
+bool rtcStateInit() {
+    if (rtcState.crc == rtcStateCrc() && rtcState.historyCount <= HISTORY_MAX
+        && rtcState.historyHead < HISTORY_MAX) {
+        return true;
+    }
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcStateSeal();
+    return false;
+}
+
+
+void rtcStateSeal() {
+    rtcState.crc = rtcStateCrc();
+}
+
+
+void historyPush(Decimal v) {
+    rtcState.history[rtcState.historyHead] = v;
+    rtcState.historyHead = (rtcState.historyHead + 1) % HISTORY_MAX;
+    if (rtcState.historyCount < HISTORY_MAX) rtcState.historyCount++;
+    rtcStateSeal();
+}
+
+
+Decimal historyGet(uint8_t age) {
+    uint8_t i = (rtcState.historyHead + HISTORY_MAX - 1 - age) % HISTORY_MAX;
+    return rtcState.history[i];
+}
@@ -0,0 +1,151 @@
+#include "stats.h"
+#include "rtc_state.h"
+#include <algorithm>
+
+static const char* const STAT_LABELS[STAT_KIND_COUNT] = {
+    "N", "SUM", "MEAN", "SD", "MIN", "MAX", "SLOPE", "ICPT", "MED", "P90", "CLEAR"
+};
+
+// raw values for the order statistics, allocated on first use; plain RAM is
+// too small to be worth it, so without PSRAM those two stats are just n/a
+static int64_t* rawValues = nullptr;
+static uint32_t rawCount = 0;
+
+// the selected order statistic, as of orderCount raw values
+static StatKind selected = STAT_MEAN;
+static double orderValue = 0;
+static uint32_t orderCount = 0;  // 0: not worked out
+
+
+// nearest-rank order statistic; nth_element is O(n)
+static double rawRank(uint32_t k) {
+    std::nth_element(rawValues, rawValues + k, rawValues + rawCount);
+    return decToDouble(Decimal{rawValues[k]});
+}
+
+
+static void updateOrderStat() {
+    orderCount = 0;
+    if (!rawValues || rawCount == 0 || rawCount != rtcState.stats.count) return;
+    if (selected == STAT_MEDIAN) {
+        uint32_t mid = rawCount / 2;
+        double upper = rawRank(mid);
+        if (rawCount % 2) {
+            orderValue = upper;
+        } else {
+            // nth_element left everything below mid in front of it
+            int64_t lower = *std::max_element(rawValues, rawValues + mid);
+            orderValue = (decToDouble(Decimal{lower}) + upper) / 2;
+        }
+    } else if (selected == STAT_P90) {
+        orderValue = rawRank((rawCount * 9 + 9) / 10 - 1);
+    } else {
+        return;
+    }
+    orderCount = rawCount;
+}
+
+
+void statsClear() {
+    memset(&rtcState.stats, 0, sizeof(rtcState.stats));
+    rtcStateSeal();
+    rawCount = 0;
+    orderCount = 0;
+}
+
+
+void statsSelect(StatKind kind) {
+    if (kind == selected && orderCount == rawCount) return;
+    selected = kind;
+    updateOrderStat();
+}
+
+
+void statsAdd(Decimal v) {
+    Stats& s = rtcState.stats;
+    if (s.count == 0) {
+        s.min = v;
+        s.max = v;
+    } else {
+        if (v.raw < s.min.raw) s.min = v;
+        if (v.raw > s.max.raw) s.max = v;
+    }
+    if (!s.sumOverflow && !decAdd(s.sum, v, &s.sum)) s.sumOverflow = true;
+
+    // Welford: update the means first, then the moments with the old and new
+    // deviations
+    s.count++;
+    double y = decToDouble(v);
+    double x = s.count;
+    double dx = x - s.meanX;
+    double dy = y - s.mean;
+    s.meanX += dx / s.count;
+    s.mean += dy / s.count;
+    s.m2X += dx * (x - s.meanX);
+    s.m2 += dy * (y - s.mean);
+    s.cXY += dx * (y - s.mean);
+    rtcStateSeal();
+
+    if (!rawValues && psramFound()) {
+        rawValues = (int64_t*)ps_malloc(STATS_RAW_MAX * sizeof(int64_t));
+    }
+    // only worth appending while the buffer still holds the whole column
+    if (rawValues && rawCount + 1 == s.count && rawCount < STATS_RAW_MAX) {
+        rawValues[rawCount++] = v.raw;
+    }
+    updateOrderStat();
+}
+
+
+uint32_t statsCount() {
+    return rtcState.stats.count;
+}
+
+
+const char* statsLabel(StatKind kind) {
+    return kind < STAT_KIND_COUNT ? STAT_LABELS[kind] : "";
+}
+
+
+bool statsValue(StatKind kind, double* out) {
+    const Stats& s = rtcState.stats;
+    if (kind == STAT_COUNT) {
+        *out = s.count;
+        return true;
+    }
+    if (s.count == 0) return false;
+    switch (kind) {
+        case STAT_SUM:
+            if (s.sumOverflow) return false;
+            *out = decToDouble(s.sum);
+            return true;
+        case STAT_MEAN:
+            *out = s.mean;
+            return true;
+        case STAT_STDDEV:
+            if (s.count < 2) return false;
+            *out = sqrt(s.m2 / (s.count - 1));
+            return true;
+        case STAT_MIN:
+            *out = decToDouble(s.min);
+            return true;
+        case STAT_MAX:
+            *out = decToDouble(s.max);
+            return true;
+        case STAT_SLOPE:
+        case STAT_INTERCEPT: {
+            if (s.count < 2) return false;
+            double slope = s.cXY / s.m2X;
+            *out = kind == STAT_SLOPE ? slope : s.mean - slope * s.meanX;
+            return true;
+        }
+        case STAT_MEDIAN:
+        case STAT_P90:
+            // worked out by statsSelect()/statsAdd(); rendering only reads it
+            if (kind != selected || orderCount == 0 || orderCount != s.count) return false;
+            *out = orderValue;
+            return true;
+        default:
+            return false;
+    }
+}
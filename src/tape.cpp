@@ -0,0 +1,104 @@
+#include "tape.h"
+
+#define TAPE_CHUNK 512  // bytes per write() during export
+
+static TapeLine fallbackLines[TAPE_FALLBACK_LINES];
+static TapeLine* lines = nullptr;
+static uint32_t capacity = 0;
+static uint32_t head = 0;   // next slot to write
+static uint32_t count = 0;
+static uint32_t total = 0;
+
+
+// first use picks the arena: PSRAM if there is any, else the internal array
+static void tapeArena() {
+    if (lines) return;
+    if (psramFound()) {
+        lines = (TapeLine*)ps_malloc(TAPE_ARENA_BYTES);
+        capacity = TAPE_ARENA_BYTES / sizeof(TapeLine);
+    }
+    if (!lines) {
+        lines = fallbackLines;
+        capacity = TAPE_FALLBACK_LINES;
+    }
+}
+
+
+void tapeAppend(Decimal value, char tag) {
+    tapeArena();
+    lines[head].raw = value.raw;
+    lines[head].tag = tag;
+    head = (head + 1) % capacity;
+    if (count < capacity) count++;
+    total++;
+}
+
+
+void tapeRetag(char tag) {
+    if (count == 0) return;
+    lines[(head + capacity - 1) % capacity].tag = tag;
+}
+
+
+void tapeClear() {
+    head = 0;
+    count = 0;
+    total = 0;
+}
+
+
+uint32_t tapeCount() {
+    return count;
+}
+
+
+uint32_t tapeTotal() {
+    return total;
+}
+
+
+uint32_t tapeCapacity() {
+    tapeArena();
+    return capacity;
+}
+
+
+TapeLine tapeGet(uint32_t age) {
+    return lines[(head + capacity - 1 - age) % capacity];
+}
+
+
+static const char* csvOp(char tag) {
+    switch (tag) {
+        case 'T': return "total";
+        case 'P': return "entry";
+        case '+': return "+";
+        case '-': return "-";
+        case '*': return "*";
+        case '/': return "/";
+        default:  return "=";
+    }
+}
+
+
+size_t tapeExportCsv(Print& out) {
+    // lines are built into one buffer and flushed a chunk at a time, so the
+    // CDC link sees a few large writes instead of three per line
+    char buf[TAPE_CHUNK];
+    size_t used = snprintf(buf, sizeof(buf), "line,value,op\r\n");
+    size_t bytes = 0;
+    uint32_t first = total - count + 1;
+    for (uint32_t age = count; age > 0; age--) {
+        if (sizeof(buf) - used < 48) {
+            bytes += out.write((const uint8_t*)buf, used);
+            used = 0;
+        }
+        TapeLine line = tapeGet(age - 1);
+        used += snprintf(buf + used, sizeof(buf) - used, "%lu,",
+                         (unsigned long)(first + count - age));
+        used += decFormat(Decimal{line.raw}, buf + used, sizeof(buf) - used);
+        used += snprintf(buf + used, sizeof(buf) - used, ",%s\r\n", csvOp(line.tag));
+    }
+    bytes += out.write((const uint8_t*)buf, used);
+    return bytes;
+}
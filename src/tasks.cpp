@@ -0,0 +1,89 @@
+#include "tasks.h"
+#include "esp_timer.h"
+
+struct TaskConfig {
+    const char* name;
+    uint16_t stack;  // bytes
+    uint8_t priority;
+    uint8_t core;
+};
+
+// loopTask (priority 1, 8 KB) is created by the Arduino core
+static const TaskConfig TASK_CONFIG[TASK_COUNT] = {
+    {"scan", 3072, 3, 1},
+    {"ui",   0,    1, ARDUINO_RUNNING_CORE},
+    {"hid",  4096, 4, 0},
+    {"ble",  3072, 2, 0},
+};
+
+static TaskHandle_t handles[TASK_COUNT];
+static uint64_t busyUs[TASK_COUNT];
+static uint64_t busySince[TASK_COUNT];  // esp_timer time, 0 = blocked
+static uint64_t windowStart = 0;
+
+
+TaskHandle_t taskStart(AppTask task, TaskFunction_t fn) {
+    const TaskConfig& c = TASK_CONFIG[task];
+    TaskHandle_t handle = nullptr;
+    xTaskCreatePinnedToCore(fn, c.name, c.stack, nullptr, c.priority, &handle, c.core);
+    taskRegister(task, handle);
+    return handle;
+}
+
+
+void taskRegister(AppTask task, TaskHandle_t handle) {
+    handles[task] = handle;
+    if (windowStart == 0) windowStart = esp_timer_get_time();
+}
+
+
+void taskBusyBegin(AppTask task) {
+    busySince[task] = esp_timer_get_time();
+}
+
+
+void taskBusyEnd(AppTask task) {
+    if (busySince[task] == 0) return;
+    busyUs[task] += esp_timer_get_time() - busySince[task];
+    busySince[task] = 0;
+}
+
+
+const char* taskName(AppTask task) {
+    return task < TASK_COUNT ? TASK_CONFIG[task].name : "";
+}
+
+
+uint8_t taskCore(AppTask task) {
+    return TASK_CONFIG[task].core;
+}
+
+
+uint8_t taskPriority(AppTask task) {
+    return handles[task] ? uxTaskPriorityGet(handles[task]) : TASK_CONFIG[task].priority;
+}
+
+
+uint16_t taskLoadPermille(AppTask task) {
+    uint64_t now = esp_timer_get_time();
+    uint64_t busy = busyUs[task];
+    uint64_t since = busySince[task];  // the task may be mid-pass on the other core
+    if (since != 0 && since < now) busy += now - since;
+    uint64_t window = now - windowStart;
+    if (window == 0) return 0;
+    return busy >= window ? 1000 : (uint16_t)(busy * 1000 / window);
+}
+
+
+uint32_t taskStackFree(AppTask task) {
+    // ESP-IDF counts stack in bytes
+    return handles[task] ? uxTaskGetStackHighWaterMark(handles[task]) : 0;
+}
+
+
+// busySince is left to its owner; a pass already running when the window
+// opens is counted whole, and the load clamps at 100%
+void taskLoadReset() {
+    windowStart = esp_timer_get_time();
+    for (uint8_t t = 0; t < TASK_COUNT; t++) busyUs[t] = 0;
+}
@@ -0,0 +1,91 @@
+#include "timers.h"
+
+static uint8_t heap[TIMER_MAX];  // timer ids, earliest due at heap[0]
+static uint8_t heapLen = 0;
+static uint8_t place[TIMER_MAX];  // heap index + 1 per id, 0 = not armed
+static uint32_t due[TIMER_MAX];
+
+
+static bool earlier(uint8_t a, uint8_t b) {
+    return (int32_t)(due[heap[a]] - due[heap[b]]) < 0;
+}
+
+
+static void swapNodes(uint8_t a, uint8_t b) {
+    uint8_t t = heap[a];
+    heap[a] = heap[b];
+    heap[b] = t;
+    place[heap[a]] = a + 1;
+    place[heap[b]] = b + 1;
+}
+
+
+static void siftUp(uint8_t i) {
+    while (i > 0 && earlier(i, (i - 1) / 2)) {
+        swapNodes(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+
+static void siftDown(uint8_t i) {
+    for (;;) {
+        uint8_t least = i;
+        uint8_t left = 2 * i + 1;
+        uint8_t right = left + 1;
+        if (left < heapLen && earlier(left, least)) least = left;
+        if (right < heapLen && earlier(right, least)) least = right;
+        if (least == i) return;
+        swapNodes(i, least);
+        i = least;
+    }
+}
+
+
+void timerArm(uint8_t id, uint32_t when) {
+    if (id >= TIMER_MAX) return;
+    if (place[id] && due[id] == when) return;
+    due[id] = when;
+    if (!place[id]) {
+        heap[heapLen] = id;
+        place[id] = ++heapLen;
+    }
+    // it may have moved either way
+    siftUp(place[id] - 1);
+    siftDown(place[id] - 1);
+}
+
+
+void timerCancel(uint8_t id) {
+    if (id >= TIMER_MAX || !place[id]) return;
+    uint8_t i = place[id] - 1;
+    place[id] = 0;
+    if (i == --heapLen) return;
+    // the last node fills the hole, then settles
+    uint8_t moved = heap[heapLen];
+    heap[i] = moved;
+    place[moved] = i + 1;
+    siftUp(i);
+    siftDown(place[moved] - 1);
+}
+
+
+bool timerArmed(uint8_t id) {
+    return id < TIMER_MAX && place[id];
+}
+
+
+int timerPopExpired(uint32_t now) {
+    if (heapLen == 0 || (int32_t)(now - due[heap[0]]) < 0) return -1;
+    uint8_t id = heap[0];
+    timerCancel(id);
+    return id;
+}
+
+
+uint32_t timerWaitMs(uint32_t now, uint32_t cap) {
+    if (heapLen == 0) return cap;
+    int32_t left = (int32_t)(due[heap[0]] - now);
+    if (left <= 0) return 0;
+    return (uint32_t)left < cap ? (uint32_t)left : cap;
+}
@@ -0,0 +1,224 @@
+#include "tvm.h"
+#include <math.h>
+
+#define TVM_NEWTON_MAX 10     // plain Newton steps before falling back
+#define TVM_TOLERANCE 1e-12   // on the rate step, relative to max(1, |rate|)
+#define TVM_RATE_MIN -0.999999
+
+// f(x) and f'(x) for the rate solver
+typedef void (*TvmFunc)(double x, const void* ctx, double* f, double* df);
+
+// sign-change search points for the fallback, as rates per period
+static const double BRACKET_GRID[] = {
+    -0.99, -0.9, -0.5, -0.2, -0.05, 0, 0.002, 0.01, 0.03, 0.07, 0.15, 0.3, 0.6, 1, 2, 5, 10
+};
+#define BRACKET_COUNT (sizeof(BRACKET_GRID) / sizeof(BRACKET_GRID[0]))
+
+
+// (1+i)^n - 1 without losing the small-rate digits
+static double growthMinusOne(double n, double i) {
+    return expm1(n * log1p(i));
+}
+
+
+bool tvmPmt(double n, double i, double pv, double fv, double* out) {
+    if (i <= -1) return false;
+    double r;
+    if (i == 0) {
+        r = -(pv + fv) / n;
+    } else {
+        double gm1 = growthMinusOne(n, i);
+        r = -(pv * (gm1 + 1) + fv) * i / gm1;
+    }
+    if (!isfinite(r)) return false;
+    *out = r;
+    return true;
+}
+
+
+bool tvmPv(double n, double i, double pmt, double fv, double* out) {
+    if (i <= -1) return false;
+    double r;
+    if (i == 0) {
+        r = -(fv + pmt * n);
+    } else {
+        double gm1 = growthMinusOne(n, i);
+        r = -(fv + pmt * gm1 / i) / (gm1 + 1);
+    }
+    if (!isfinite(r)) return false;
+    *out = r;
+    return true;
+}
+
+
+bool tvmFv(double n, double i, double pv, double pmt, double* out) {
+    if (i <= -1) return false;
+    double r;
+    if (i == 0) {
+        r = -(pv + pmt * n);
+    } else {
+        double gm1 = growthMinusOne(n, i);
+        r = -(pv * (gm1 + 1) + pmt * gm1 / i);
+    }
+    if (!isfinite(r)) return false;
+    *out = r;
+    return true;
+}
+
+
+bool tvmN(double i, double pv, double pmt, double fv, double* out) {
+    if (i <= -1) return false;
+    double r;
+    if (i == 0) {
+        r = -(pv + fv) / pmt;
+    } else {
+        // (1+i)^n = (pmt - fv*i) / (pmt + pv*i)
+        double ratio = (pmt - fv * i) / (pmt + pv * i);
+        if (!(ratio > 0)) return false;
+        r = log(ratio) / log1p(i);
+    }
+    if (!isfinite(r)) return false;
+    *out = r;
+    return true;
+}
+
+
+struct RateCtx {
+    double n, pv, pmt, fv;
+};
+
+
+static void rateFunc(double i, const void* ctx, double* f, double* df) {
+    const RateCtx* c = (const RateCtx*)ctx;
+    if (fabs(i) < 1e-9) {
+        // limits at i = 0: the annuity factor is n, its slope n(n-1)/2
+        *f = c->pv + c->pmt * c->n + c->fv;
+        *df = c->pv * c->n + c->pmt * c->n * (c->n - 1) / 2;
+        return;
+    }
+    double gm1 = growthMinusOne(c->n, i);
+    double g = gm1 + 1;
+    double dg = c->n * g / (1 + i);
+    *f = c->pv * g + c->pmt * gm1 / i + c->fv;
+    *df = c->pv * dg + c->pmt * (dg * i - gm1) / (i * i);
+}
+
+
+struct IrrCtx {
+    const double* flows;
+    uint8_t count;
+};
+
+
+static void irrFunc(double r, const void* ctx, double* f, double* df) {
+    const IrrCtx* c = (const IrrCtx*)ctx;
+    double v = 1 / (1 + r);
+    double pw = 1;  // v^k
+    *f = 0;
+    *df = 0;
+    for (uint8_t k = 0; k < c->count; k++) {
+        *f += c->flows[k] * pw;
+        *df -= k * c->flows[k] * pw * v;
+        pw *= v;
+    }
+}
+
+
+static bool converged(double step, double x) {
+    return fabs(step) <= TVM_TOLERANCE * fmax(1.0, fabs(x));
+}
+
+
+static bool solve(TvmFunc fn, const void* ctx, double guess, double* out, TvmStats* stats) {
+    uint32_t start = micros();
+    TvmStats local = {0, false, 0};
+    TvmStats* s = stats ? stats : &local;
+    *s = local;
+    bool ok = false;
+    double f, df;
+
+    // fast path: plain Newton from the guess
+    double x = guess;
+    while (s->iterations < TVM_NEWTON_MAX) {
+        fn(x, ctx, &f, &df);
+        s->iterations++;
+        if (!isfinite(f) || !isfinite(df) || df == 0) break;
+        double step = f / df;
+        double next = x - step;
+        if (!isfinite(next) || next <= TVM_RATE_MIN) break;
+        x = next;
+        if (converged(step, x)) {
+            ok = true;
+            break;
+        }
+    }
+
+    if (!ok) {
+        // fallback: find a sign change on the grid nearest the guess, then
+        // take Newton steps that stay inside it and bisect when they don't
+        s->bisected = true;
+        double lo = 0, hi = 0, flo = 0, prevX = 0, prevF = 0;
+        bool found = false;
+        for (uint8_t k = 0; k < BRACKET_COUNT && s->iterations < TVM_ITER_MAX; k++) {
+            fn(BRACKET_GRID[k], ctx, &f, &df);
+            s->iterations++;
+            if (!isfinite(f)) continue;
+            if (f == 0) {
+                x = BRACKET_GRID[k];
+                ok = true;
+                break;
+            }
+            if (k > 0 && isfinite(prevF) && (prevF < 0) != (f < 0)
+                && (!found || fabs(prevX - guess) < fabs(lo - guess))) {
+                lo = prevX;
+                hi = BRACKET_GRID[k];
+                flo = prevF;
+                found = true;
+            }
+            prevX = BRACKET_GRID[k];
+            prevF = f;
+        }
+
+        if (!ok) x = (lo + hi) / 2;
+        while (found && !ok && s->iterations < TVM_ITER_MAX
+               && micros() - start < TVM_BUDGET_US) {
+            fn(x, ctx, &f, &df);
+            s->iterations++;
+            if (f == 0) {
+                ok = true;
+                break;
+            }
+            // keep the sign change between lo and hi
+            if ((f < 0) == (flo < 0)) {
+                lo = x;
+                flo = f;
+            } else {
+                hi = x;
+            }
+            double next = df != 0 ? x - f / df : lo;
+            if (!(next >= lo && next <= hi)) next = (lo + hi) / 2;
+            double step = next - x;
+            x = next;
+            if (converged(step, x) || converged(hi - lo, x)) ok = true;
+        }
+    }
+
+    s->micros = micros() - start;
+    if (!ok || !isfinite(x)) return false;
+    *out = x;
+    return true;
+}
+
+
+bool tvmRate(double n, double pv, double pmt, double fv, double* out, TvmStats* stats) {
+    if (!(n > 0)) return false;
+    RateCtx ctx = {n, pv, pmt, fv};
+    return solve(rateFunc, &ctx, 0.01, out, stats);
+}
+
+
+bool tvmIrr(const double* flows, uint8_t count, double* out, TvmStats* stats) {
+    if (count < 2 || count > TVM_FLOW_MAX) return false;
+    IrrCtx ctx = {flows, count};
+    return solve(irrFunc, &ctx, 0.1, out, stats);
+}
@@ -0,0 +1,18 @@
+// The firmware's console on stdin/stdout, for ttcfg_loopback.py to talk to
+// over a pty: the real frame parser and the real exportConfig()/importConfig()
+// behind it, with NVS in memory and no display attached. Between polls it
+// waits as an idle calc-mode loop() does (HID never started, nothing
+// scheduled), so a reply only comes as soon as loopWait() lets it.
+#include "../../src/main.cpp"
+
+int main() {
+    defaultSettings();
+    u8g2.begin();
+    consoleBegin();
+    consoleSetFrameHandler(handleConfigFrame);
+    bootFinished = true;
+    for (;;) {
+        consolePoll(CONSOLE_COMMANDS, CONSOLE_COMMAND_COUNT);
+        loopWait();
+    }
+}
@@ -0,0 +1,155 @@
+// Host stand-ins for the hardware the firmware talks to: the USB console
+// is stdin/stdout, NVS lives in memory, and the HID, BLE and battery
+// modules (src/hid*.cpp, src/battery.cpp are not built here) do nothing.
+#include <Arduino.h>
+#include <Preferences.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <chrono>
+#include <thread>
+#include <poll.h>
+#include <unistd.h>
+#include "hid.h"
+#include "hid_ble.h"
+#include "battery.h"
+#include "soc/usb_serial_jtag_reg.h"
+
+HWCDC Serial;
+TwoWire Wire;
+SPIClass SPI;
+
+static const auto hostStart = std::chrono::steady_clock::now();
+
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - hostStart).count();
+}
+
+unsigned long millis() {
+    return micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+
+// --- console ---
+
+int HWCDC::available() {
+    if (pending < 0) {
+        struct pollfd p = {0, POLLIN, 0};
+        uint8_t c;
+        if (poll(&p, 1, 0) == 1 && (p.revents & POLLIN) && ::read(0, &c, 1) == 1) pending = c;
+    }
+    return pending >= 0 ? 1 : 0;
+}
+
+int HWCDC::read() {
+    if (!available()) return -1;
+    int c = pending;
+    pending = -1;
+    return c;
+}
+
+
+// --- registers ---
+
+// the Serial/JTAG start-of-frame counter: the pty always has a host on it
+uint32_t hostRegRead(uint32_t reg) {
+    return reg == USB_SERIAL_JTAG_FRAM_NUM_REG ? (uint32_t)millis() : 0;
+}
+
+
+// --- FreeRTOS ---
+
+BaseType_t xQueuePeek(QueueHandle_t, void*, TickType_t wait) {
+    if (wait != portMAX_DELAY) delay(wait * portTICK_PERIOD_MS);
+    return pdFALSE;
+}
+
+
+// --- Preferences ---
+
+static std::map<std::string, std::map<std::string, std::vector<uint8_t>>> nvs;
+
+bool Preferences::begin(const char* name, bool) {
+    ns_ = &nvs[name];
+    return true;
+}
+
+bool Preferences::clear() {
+    if (ns_) ns_->clear();
+    return ns_ != nullptr;
+}
+
+bool Preferences::remove(const char* key) {
+    return ns_ && ns_->erase(key) > 0;
+}
+
+bool Preferences::isKey(const char* key) {
+    return ns_ && ns_->count(key) > 0;
+}
+
+size_t Preferences::putBytes(const char* key, const void* value, size_t len) {
+    if (!ns_) return 0;
+    const uint8_t* p = (const uint8_t*)value;
+    (*ns_)[key].assign(p, p + len);
+    return len;
+}
+
+size_t Preferences::getBytes(const char* key, void* buf, size_t maxLen) {
+    if (!ns_ || !ns_->count(key)) return 0;
+    const std::vector<uint8_t>& v = (*ns_)[key];
+    if (v.size() > maxLen) return 0;
+    memcpy(buf, v.data(), v.size());
+    return v.size();
+}
+
+size_t Preferences::getBytesLength(const char* key) {
+    return ns_ && ns_->count(key) ? (*ns_)[key].size() : 0;
+}
+
+
+// --- hid.h ---
+
+bool hidInitialized = false;
+
+void hidInit() {}
+void hidBegin() {}
+void hidSendKey(char, bool) {}
+void hidSendString(const char*) {}
+void hidSendNumpadKey(char, bool) {}
+bool hidUsbMounted() { return false; }
+bool hidQueueString(const char*) { return true; }
+void hidFlush() {}
+bool hidBusy() { return false; }
+
+
+// --- hid_ble.h: no bonds, never connected ---
+
+void hidBleInit(bool) {}
+void hidBleDeinit() {}
+bool hidBleIsActive() { return false; }
+bool hidBleIsConnected() { return false; }
+uint8_t hidBleGetBondCount() { return 0; }
+void hidBleClearAllBonds() {}
+String hidBleGetBondAddress(uint8_t) { return String(""); }
+bool hidBleDeleteBond(uint8_t) { return false; }
+void hidBleSendNumpadKey(char, bool) {}
+void hidBleSendString(const char*) {}
+void hidBleTypeChar(char) {}
+void hidBleClearReport() {}
+void hidBleApplyFastConnParams() {}
+const uint8_t* hidBleGetPeerMac() { return nullptr; }
+
+
+// --- battery.h: a steady, mid-charge cell ---
+
+void batteryBegin() {}
+void batteryStop() {}
+uint32_t batteryPoll() { return 0; }
+bool batterySampling() { return false; }
+int batteryPinMv() { return 1900; }
+int batteryMv() { return 3800; }
+int batteryPercent() { return 50; }
@@ -0,0 +1,82 @@
+// Round-trip check for numfmt: the shortest digits fmtDouble() writes must
+// read back through strtod as the very same double, and fmtDecimal() text
+// must parse back through decParse as the same Decimal.
+//
+//   numfmt_roundtrip [stride] [randoms]
+//
+// Sweeps every `stride`-th float32 bit pattern (default 7, about 613M values;
+// stride 1 is all 4G) widened to double, then `randoms` random doubles and
+// Decimals (default 50M) from a fixed seed.
+#include <Arduino.h>
+#include "numfmt.h"
+
+static long failures = 0;
+
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+static uint64_t rng64() {  // xorshift64*: fixed seed, same run every time
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return rngState * 0x2545F4914F6CDD1DULL;
+}
+
+
+static void checkDouble(double v) {
+    char buf[32];
+    fmtDouble(v, buf, 24);
+    double back = strtod(buf, nullptr);
+    if (memcmp(&back, &v, sizeof(v)) != 0) {
+        if (failures < 10) printf("MISMATCH double %.17g -> %s\n", v, buf);
+        failures++;
+    }
+}
+
+
+static void checkDecimal(Decimal v) {
+    char buf[32];
+    Decimal back = {0};
+    fmtDecimal(v, buf, 24);
+    if (!decParse(buf, &back) || back.raw != v.raw) {
+        if (failures < 10) printf("MISMATCH decimal %lld -> %s\n", (long long)v.raw, buf);
+        failures++;
+    }
+}
+
+
+int main(int argc, char** argv) {
+    uint32_t stride = argc > 1 ? strtoul(argv[1], nullptr, 10) : 7;
+    long randoms = argc > 2 ? atol(argv[2]) : 50000000;
+    if (stride == 0) stride = 1;
+
+    long values = 0;
+    for (uint64_t bits = 0; bits <= 0xFFFFFFFFULL; bits += stride) {
+        uint32_t b = (uint32_t)bits;
+        float f;
+        memcpy(&f, &b, sizeof(f));
+        if (f != f || f - f != 0) continue;  // NaN, inf
+        checkDouble(f);
+        values++;
+    }
+    printf("float32 sweep: %ld values, stride %lu\n", values, (unsigned long)stride);
+
+    long doubles = 0;
+    for (long i = 0; i < randoms; i++) {
+        uint64_t bits = rng64();
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        if (v != v || v - v != 0) continue;
+        checkDouble(v);
+        doubles++;
+    }
+    for (long i = 0; i < randoms; i++) {
+        // spread over magnitudes: a random raw shifted down by 0..62 bits
+        int64_t raw = (int64_t)(rng64() >> (i % 63));
+        checkDecimal(Decimal{i & 1 ? -raw : raw});
+    }
+    printf("random: %ld doubles, %ld decimals\n", doubles, randoms);
+
+    printf("round-trip: %ld failures\n", failures);
+    return failures ? 1 : 0;
+}
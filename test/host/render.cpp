@@ -0,0 +1,108 @@
+// Host renderer: every view of the firmware drawn by its own drawing code
+// and real U8g2 into a memory frame, with no display attached.
+//
+//   render                      print us/frame for each view
+//   render --out DIR            also write DIR/<view>.pbm
+//   render --golden DIR         compare each view with DIR/<view>.pbm; exit 1 on
+//                               any difference or missing image
+//
+// main.cpp is included rather than linked so the static draw functions and
+// forEachView() are reachable.
+#include "../../src/main.cpp"
+
+#include <sys/stat.h>
+
+#define FRAME_BYTES (128 * 64 / 8)
+#define BENCH_FRAMES 200
+
+static const char* outDir = nullptr;
+static const char* goldenDir = nullptr;
+static int failures = 0;
+
+
+static void toPbm(const uint8_t* tiles, uint8_t* pbm) {
+    for (int y = 0; y < 64; y++) frameRowToPbm(tiles, y, pbm + y * 16);
+}
+
+
+static bool readPbm(const char* path, uint8_t* pbm) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    char header[11];
+    bool ok = fread(header, 1, 10, f) == 10 && memcmp(header, "P4\n128 64\n", 10) == 0
+              && fread(pbm, 1, FRAME_BYTES, f) == FRAME_BYTES;
+    fclose(f);
+    return ok;
+}
+
+
+static void writePbm(const char* path, const uint8_t* pbm) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "%s: can't write\n", path);
+        failures++;
+        return;
+    }
+    fputs("P4\n128 64\n", f);
+    fwrite(pbm, 1, FRAME_BYTES, f);
+    fclose(f);
+}
+
+
+static void visitView(const char* name, void (*draw)()) {
+    uint8_t tiles[FRAME_BYTES], pbm[FRAME_BYTES];
+    captureFrame(draw, tiles);
+    toPbm(tiles, pbm);
+
+    char path[256];
+    const char* verdict = "";
+    if (outDir) {
+        snprintf(path, sizeof(path), "%s/%s.pbm", outDir, name);
+        writePbm(path, pbm);
+    }
+    if (goldenDir) {
+        uint8_t golden[FRAME_BYTES];
+        snprintf(path, sizeof(path), "%s/%s.pbm", goldenDir, name);
+        if (!readPbm(path, golden)) {
+            verdict = "  MISSING golden";
+            failures++;
+        } else {
+            int diff = 0;
+            for (int i = 0; i < FRAME_BYTES; i++) diff += __builtin_popcount(pbm[i] ^ golden[i]);
+            static char buf[32];
+            snprintf(buf, sizeof(buf), diff ? "  DIFF %d px" : "  ok", diff);
+            verdict = buf;
+            if (diff) failures++;
+        }
+    }
+
+    uint32_t t0 = micros();
+    for (int i = 0; i < BENCH_FRAMES; i++) renderFrame(draw);
+    uint32_t us = micros() - t0;
+    printf("%-10s %8.2f us/frame%s\n", name, (double)us / BENCH_FRAMES, verdict);
+}
+
+
+int main(int argc, char** argv) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            outDir = argv[++i];
+            mkdir(outDir, 0755);  // may already exist
+        } else if (!strcmp(argv[i], "--golden") && i + 1 < argc) {
+            goldenDir = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--out DIR] [--golden DIR]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // a first boot with stock settings, as setup() would leave it
+    defaultSettings();
+    u8g2.begin();
+    u8g2.setFlipMode(1);
+    frameLogMuted = true;
+
+    forEachView(visitView);
+    if (failures) fprintf(stderr, "%d view(s) failed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,212 @@
+// Host stand-in for the parts of the Arduino-ESP32 core the firmware and
+// U8g2 use, so the drawing code can run on a PC (see test/host/Makefile).
+// Hardware calls are no-ops; time comes from the host clock.
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <math.h>
+#include <ctype.h>
+#include <string>
+
+#ifndef ARDUINO
+#define ARDUINO 10819
+#endif
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define ONLOW 0x04
+#define ADC_11db 3
+#define LSBFIRST 0
+#define MSBFIRST 1
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define EXT_RAM_ATTR
+#define PROGMEM
+#define pgm_read_byte(p) (*(const uint8_t*)(p))
+#define ARDUINO_RUNNING_CORE 1
+#define digitalPinToInterrupt(p) (p)
+
+class String {
+public:
+    String(const char* s = "") : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    explicit String(char c) : s_(1, c) {}
+    explicit String(int v) : s_(std::to_string(v)) {}
+    explicit String(unsigned v) : s_(std::to_string(v)) {}
+    explicit String(long v) : s_(std::to_string(v)) {}
+    explicit String(unsigned long v) : s_(std::to_string(v)) {}
+    String(double v, int digits) {
+        char t[48];
+        snprintf(t, sizeof(t), "%.*f", digits, v);
+        s_ = t;
+    }
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o) { s_ += o; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    friend String operator+(const String& a, const String& b) { return String(a.s_ + b.s_); }
+    friend String operator+(const String& a, const char* b) { return String(a.s_ + b); }
+    friend String operator+(const String& a, char b) { return String(a.s_ + b); }
+    bool operator==(const char* o) const { return s_ == o; }
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator!=(const char* o) const { return s_ != o; }
+    unsigned length() const { return s_.size(); }
+    const char* c_str() const { return s_.c_str(); }
+    char charAt(unsigned i) const { return i < s_.size() ? s_[i] : 0; }
+    char operator[](unsigned i) const { return charAt(i); }
+    int indexOf(char c) const { size_t p = s_.find(c); return p == std::string::npos ? -1 : (int)p; }
+    bool startsWith(const char* p) const { return s_.compare(0, strlen(p), p) == 0; }
+    bool endsWith(const char* p) const {
+        size_t n = strlen(p);
+        return s_.size() >= n && s_.compare(s_.size() - n, n, p) == 0;
+    }
+    String substring(unsigned from, unsigned to = ~0u) const {
+        if (from > s_.size()) from = s_.size();
+        if (to > s_.size()) to = s_.size();
+        return String(s_.substr(from, to > from ? to - from : 0));
+    }
+    void remove(unsigned i) { if (i < s_.size()) s_.erase(i); }
+    void remove(unsigned i, unsigned n) { if (i < s_.size()) s_.erase(i, n); }
+    void toUpperCase() { for (char& c : s_) c = toupper(c); }
+    long toInt() const { return atol(s_.c_str()); }
+    double toDouble() const { return atof(s_.c_str()); }
+private:
+    std::string s_;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buf, size_t n) {
+        size_t done = 0;
+        while (n--) done += write(*buf++);
+        return done;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write(s.c_str()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return printf("%d", v); }
+    size_t print(unsigned v) { return printf("%u", v); }
+    size_t print(long v) { return printf("%ld", v); }
+    size_t print(unsigned long v) { return printf("%lu", v); }
+    size_t print(double v, int digits = 2) { return printf("%.*f", digits, v); }
+    size_t println(const char* s = "") { return write(s) + write("\r\n"); }
+    size_t println(unsigned long v) { return print(v) + println(); }
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[256];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        return write((const uint8_t*)buf, (size_t)n < sizeof(buf) ? n : sizeof(buf) - 1);
+    }
+    virtual void flush() {}
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+    virtual int peek() { return -1; }
+    size_t readBytes(uint8_t* buf, size_t n) {
+        size_t got = 0;
+        int c;
+        while (got < n && (c = read()) >= 0) buf[got++] = (uint8_t)c;
+        return got;
+    }
+    void setTimeout(unsigned long) {}
+    int availableForWrite() { return 4096; }
+};
+
+typedef const char* esp_event_base_t;
+typedef void (*esp_event_handler_t)(void* arg, esp_event_base_t base, int32_t id, void* data);
+typedef enum {
+    ARDUINO_HW_CDC_CONNECTED_EVENT,
+    ARDUINO_HW_CDC_BUS_RESET_EVENT,
+    ARDUINO_HW_CDC_RX_EVENT,
+    ARDUINO_HW_CDC_TX_EVENT
+} arduino_hw_cdc_event_t;
+
+// the USB console: stdout, and stdin read without blocking (host_hw.cpp).
+// No events are raised: loops poll it.
+class HWCDC : public Stream {
+public:
+    void begin(unsigned long = 115200) {}
+    void setTxTimeoutMs(uint32_t) {}
+    void onEvent(arduino_hw_cdc_event_t, esp_event_handler_t) {}
+    operator bool() const { return true; }
+    int available() override;
+    int read() override;
+    size_t write(uint8_t c) override { return write(&c, 1); }
+    size_t write(const uint8_t* buf, size_t n) override {
+        n = fwrite(buf, 1, n, stdout);
+        fflush(stdout);
+        return n;
+    }
+    using Print::write;
+private:
+    int pending = -1;
+};
+extern HWCDC Serial;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+inline void delayMicroseconds(unsigned) {}
+inline void yield() {}
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }  // every key up
+inline void analogWrite(uint8_t, int) {}
+inline uint32_t analogReadMilliVolts(uint8_t) { return 0; }
+inline void analogSetPinAttenuation(uint8_t, int) {}
+inline void attachInterrupt(uint8_t, void (*)(), int) {}
+inline void attachInterruptArg(uint8_t, void (*)(void*), void*, int) {}
+
+inline bool psramFound() { return false; }
+inline void* ps_malloc(size_t n) { return malloc(n); }
+inline void* ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+inline uint32_t getCpuFrequencyMhz() { return 240; }
+inline bool setCpuFrequencyMhz(uint32_t) { return true; }
+
+// newlib has strlcpy; older glibc does not
+inline size_t hostStrlcpy(char* dst, const char* src, size_t size) {
+    size_t n = strlen(src);
+    if (size) {
+        size_t k = n < size - 1 ? n : size - 1;
+        memcpy(dst, src, k);
+        dst[k] = 0;
+    }
+    return n;
+}
+#define strlcpy hostStrlcpy
+
+template <class T> const T& min(const T& a, const T& b) { return a < b ? a : b; }
+template <class T> const T& max(const T& a, const T& b) { return a > b ? a : b; }
+
+#include "esp_system.h"
+#include "esp_sleep.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#endif
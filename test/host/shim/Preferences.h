@@ -0,0 +1,40 @@
+#ifndef HOST_PREFERENCES_H
+#define HOST_PREFERENCES_H
+
+#include "Arduino.h"
+#include <map>
+#include <vector>
+
+// NVS held in memory for the life of the process, one map per namespace
+class Preferences {
+public:
+    bool begin(const char* name, bool readOnly = false);
+    void end() { ns_ = nullptr; }
+    bool clear();
+    bool remove(const char* key);
+    bool isKey(const char* key);
+
+    size_t putBytes(const char* key, const void* value, size_t len);
+    size_t getBytes(const char* key, void* buf, size_t maxLen);
+    size_t getBytesLength(const char* key);
+
+    size_t putUChar(const char* key, uint8_t v) { return putBytes(key, &v, sizeof(v)); }
+    size_t putBool(const char* key, bool v) { return putUChar(key, v); }
+    size_t putULong(const char* key, uint32_t v) { return putBytes(key, &v, sizeof(v)); }
+    size_t putLong64(const char* key, int64_t v) { return putBytes(key, &v, sizeof(v)); }
+    size_t putString(const char* key, const char* v) { return putBytes(key, v, strlen(v) + 1); }
+    uint8_t getUChar(const char* key, uint8_t def = 0) { return get(key, def); }
+    bool getBool(const char* key, bool def = false) { return getUChar(key, def) != 0; }
+    uint32_t getULong(const char* key, uint32_t def = 0) { return get(key, def); }
+    int64_t getLong64(const char* key, int64_t def = 0) { return get(key, def); }
+    size_t freeEntries() { return 256; }
+
+private:
+    template <class T> T get(const char* key, T def) {
+        T v;
+        return getBytesLength(key) == sizeof(T) && getBytes(key, &v, sizeof(T)) == sizeof(T) ? v : def;
+    }
+    std::map<std::string, std::vector<uint8_t>>* ns_ = nullptr;
+};
+
+#endif
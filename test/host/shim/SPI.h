@@ -0,0 +1,29 @@
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+#include "Arduino.h"
+
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+#define SPI_CLOCK_DIV2 2
+
+struct SPISettings {
+    SPISettings(uint32_t = 0, uint8_t = MSBFIRST, uint8_t = SPI_MODE0) {}
+};
+
+class SPIClass {
+public:
+    void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {}
+    void end() {}
+    void beginTransaction(SPISettings) {}
+    void endTransaction() {}
+    uint8_t transfer(uint8_t) { return 0; }
+    void setClockDivider(uint32_t) {}
+    void setBitOrder(uint8_t) {}
+    void setDataMode(uint8_t) {}
+};
+extern SPIClass SPI;
+
+#endif
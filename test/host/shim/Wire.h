@@ -0,0 +1,23 @@
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include "Arduino.h"
+
+// I2C that goes nowhere; U8g2's Arduino byte callback talks to this
+class TwoWire {
+public:
+    bool begin() { return true; }
+    bool begin(int, int, uint32_t = 0) { return true; }
+    void end() {}
+    void setClock(uint32_t) {}
+    void beginTransmission(uint8_t) {}
+    uint8_t endTransmission(bool = true) { return 0; }
+    size_t write(uint8_t) { return 1; }
+    size_t write(const uint8_t*, size_t n) { return n; }
+    uint8_t requestFrom(uint8_t, uint8_t) { return 0; }
+    int available() { return 0; }
+    int read() { return -1; }
+};
+extern TwoWire Wire;
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef HOST_DRIVER_RTC_IO_H
+#define HOST_DRIVER_RTC_IO_H
+
+#include "esp_system.h"
+
+inline esp_err_t rtc_gpio_pullup_en(gpio_num_t) { return ESP_OK; }
+inline esp_err_t rtc_gpio_pulldown_dis(gpio_num_t) { return ESP_OK; }
+
+#endif
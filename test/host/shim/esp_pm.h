@@ -0,0 +1,22 @@
+#ifndef HOST_ESP_PM_H
+#define HOST_ESP_PM_H
+
+#include "esp_system.h"
+
+// like a core built without CONFIG_PM_ENABLE: configuration is refused
+typedef enum { ESP_PM_CPU_FREQ_MAX, ESP_PM_APB_FREQ_MAX, ESP_PM_NO_LIGHT_SLEEP } esp_pm_lock_type_t;
+typedef struct esp_pm_lock* esp_pm_lock_handle_t;
+typedef struct {
+    int max_freq_mhz;
+    int min_freq_mhz;
+    bool light_sleep_enable;
+} esp_pm_config_esp32s3_t;
+
+inline esp_err_t esp_pm_configure(const void*) { return ESP_ERR_NOT_SUPPORTED; }
+inline esp_err_t esp_pm_lock_create(esp_pm_lock_type_t, int, const char*, esp_pm_lock_handle_t*) {
+    return ESP_ERR_NOT_SUPPORTED;
+}
+inline esp_err_t esp_pm_lock_acquire(esp_pm_lock_handle_t) { return ESP_OK; }
+inline esp_err_t esp_pm_lock_release(esp_pm_lock_handle_t) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef HOST_ESP_SLEEP_H
+#define HOST_ESP_SLEEP_H
+
+#include "esp_system.h"
+#include <stdlib.h>
+
+typedef enum {
+    ESP_SLEEP_WAKEUP_UNDEFINED,
+    ESP_SLEEP_WAKEUP_ALL,
+    ESP_SLEEP_WAKEUP_EXT0,
+    ESP_SLEEP_WAKEUP_EXT1,
+    ESP_SLEEP_WAKEUP_TIMER,
+    ESP_SLEEP_WAKEUP_GPIO = 7
+} esp_sleep_wakeup_cause_t;
+typedef esp_sleep_wakeup_cause_t esp_sleep_source_t;
+
+inline esp_sleep_wakeup_cause_t esp_sleep_get_wakeup_cause() { return ESP_SLEEP_WAKEUP_UNDEFINED; }
+inline esp_err_t esp_sleep_enable_ext0_wakeup(gpio_num_t, int) { return ESP_OK; }
+inline esp_err_t esp_sleep_enable_gpio_wakeup() { return ESP_OK; }
+inline esp_err_t esp_sleep_enable_timer_wakeup(uint64_t) { return ESP_OK; }
+inline esp_err_t esp_sleep_disable_wakeup_source(esp_sleep_source_t) { return ESP_OK; }
+inline esp_err_t esp_light_sleep_start() { return ESP_OK; }
+inline void esp_deep_sleep_start() { exit(0); }
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef HOST_ESP_SYSTEM_H
+#define HOST_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_NOT_SUPPORTED 0x106
+#define ESP_ERR_TIMEOUT 0x107
+#define BIT(n) (1UL << (n))
+
+typedef int gpio_num_t;
+
+inline size_t esp_get_free_heap_size() { return 256 * 1024; }
+inline uint32_t esp_get_minimum_free_heap_size() { return 256 * 1024; }
+inline uint32_t esp_random() { return 4; }
+
+#endif
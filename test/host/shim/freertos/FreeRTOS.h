@@ -0,0 +1,31 @@
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+
+// Just enough FreeRTOS to link. The host build runs everything on one thread,
+// so tasks are never started, queues are never created and waits return at
+// once, except xQueuePeek() (queue.h).
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portMAX_DELAY 0xffffffffu
+#define portTICK_PERIOD_MS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define configMAX_PRIORITIES 25
+#define portYIELD_FROM_ISR() do {} while (0)
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0}
+inline void taskENTER_CRITICAL(portMUX_TYPE*) {}
+inline void taskEXIT_CRITICAL(portMUX_TYPE*) {}
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef HOST_FREERTOS_QUEUE_H
+#define HOST_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+inline QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return nullptr; }
+inline BaseType_t xQueueSend(QueueHandle_t, const void*, TickType_t) { return pdFALSE; }
+inline BaseType_t xQueueReceive(QueueHandle_t, void*, TickType_t) { return pdFALSE; }
+// nothing is ever queued, so a wait on an event just sleeps out its timeout
+// (host_hw.cpp): a loop blocked here is deaf to the console as on the device
+BaseType_t xQueuePeek(QueueHandle_t queue, void* item, TickType_t wait);
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t) { return 0; }
+inline UBaseType_t uxQueueSpacesAvailable(QueueHandle_t) { return 0; }
+
+#endif
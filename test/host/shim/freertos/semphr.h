@@ -0,0 +1,11 @@
+#ifndef HOST_FREERTOS_SEMPHR_H
+#define HOST_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return nullptr; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdFALSE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t, BaseType_t*) { return pdTRUE; }
+
+#endif
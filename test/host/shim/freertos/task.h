@@ -0,0 +1,25 @@
+#ifndef HOST_FREERTOS_TASK_H
+#define HOST_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+inline BaseType_t xTaskCreate(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t, TaskHandle_t* h) {
+    if (h) *h = nullptr;
+    return pdPASS;
+}
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char*, uint32_t, void*, UBaseType_t,
+                                          TaskHandle_t* h, BaseType_t) {
+    if (h) *h = nullptr;
+    return pdPASS;
+}
+inline void vTaskDelete(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t) {}
+inline void vTaskSuspend(TaskHandle_t) {}
+inline void vTaskResume(TaskHandle_t) {}
+inline TaskHandle_t xTaskGetCurrentTaskHandle() { return nullptr; }
+inline UBaseType_t uxTaskPriorityGet(TaskHandle_t) { return 1; }
+inline UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) { return 0; }
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+
+#endif
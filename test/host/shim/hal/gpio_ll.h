@@ -0,0 +1,10 @@
+#ifndef HOST_HAL_GPIO_LL_H
+#define HOST_HAL_GPIO_LL_H
+
+#include "driver/gpio.h"
+
+typedef struct { int unused; } gpio_dev_t;
+static gpio_dev_t GPIO;
+static inline void gpio_ll_intr_disable(gpio_dev_t*, gpio_num_t) {}
+
+#endif
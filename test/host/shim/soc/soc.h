@@ -0,0 +1,10 @@
+#ifndef HOST_SOC_SOC_H
+#define HOST_SOC_SOC_H
+
+#include <stdint.h>
+
+// register reads go through hostRegRead() (host_hw.cpp)
+uint32_t hostRegRead(uint32_t reg);
+#define REG_GET_FIELD(reg, field) ((hostRegRead(reg) >> (field##_S)) & (field##_V))
+
+#endif
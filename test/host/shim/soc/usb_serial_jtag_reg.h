@@ -0,0 +1,8 @@
+#ifndef HOST_SOC_USB_SERIAL_JTAG_REG_H
+#define HOST_SOC_USB_SERIAL_JTAG_REG_H
+
+#define USB_SERIAL_JTAG_FRAM_NUM_REG 0x60038024
+#define USB_SERIAL_JTAG_SOF_FRAME_INDEX_V 0x7FF
+#define USB_SERIAL_JTAG_SOF_FRAME_INDEX_S 0
+
+#endif
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+"""tools/ttcfg.py against the firmware's own config handler, over a pty.
+
+build/config_device (config_device.cpp) runs main.cpp's console on one end of
+a pseudo-terminal; ttcfg opens the other end as if it were /dev/ttyACM0. Every
+dump and load below goes through the real framing, CRC and import checks.
+
+    ttcfg_loopback.py build/config_device
+"""
+import os, pty, struct, subprocess, sys, time, tty, zlib
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), "..", "..", "tools"))
+import ttcfg  # noqa: E402
+
+HEADER = ttcfg.SETTINGS_HEADER.size
+# SettingsBlob field offsets after the header: sleepMs, then one byte each
+SLEEP, ZOOM, BATCH_SEP, QBIND = HEADER + 0, HEADER + 6, HEADER + 7, HEADER + 9
+
+failures = 0
+
+
+def check(what, ok):
+    global failures
+    print(f"{'ok  ' if ok else 'FAIL'} {what}")
+    if not ok:
+        failures += 1
+
+
+def patch(image, offset, fmt, value):
+    # change one settings field and reseal the blob's CRC, as a tool would
+    blob_len = HEADER + ttcfg.SETTINGS_HEADER.unpack_from(image)[1]
+    image = bytearray(image)
+    struct.pack_into(fmt, image, offset, value)
+    struct.pack_into("<I", image, 4, zlib.crc32(image[HEADER:blob_len]))
+    return bytes(image)
+
+
+def rejected(port, image):
+    try:
+        ttcfg.transact(port, ttcfg.CONFIG_PUT, image)
+    except ValueError as e:
+        return "bad settings" in str(e)
+    return False
+
+
+def split_frame_reply(port, pause):
+    # a frame that reaches the device in two pieces, as a slow host might send it
+    frame = b"\n" + ttcfg.encode_frame(ttcfg.CONFIG_GET)
+    fd = ttcfg.open_port(port)
+    try:
+        os.write(fd, frame[:4])
+        time.sleep(pause)
+        os.write(fd, frame[4:])
+        reply_cmd, reply = ttcfg.read_frame(fd)
+    finally:
+        os.close(fd)
+    return reply_cmd == ttcfg.CONFIG_GET | ttcfg.CONFIG_REPLY and reply[:1] == b"\0"
+
+
+def main():
+    master, slave = pty.openpty()
+    tty.setraw(slave)
+    port = os.ttyname(slave)
+    device = subprocess.Popen([sys.argv[1]], stdin=master, stdout=master)
+    try:
+        image = ttcfg.transact(port, ttcfg.CONFIG_GET)
+        blob, formulas = ttcfg.split_image(image)
+        check(f"dump: {len(image)} B image, settings v{struct.unpack_from('<H', blob)[0]}", True)
+
+        check("load of the dumped image", ttcfg.transact(port, ttcfg.CONFIG_PUT, image) == b"")
+        one_minute = patch(image, SLEEP, "<I", 60000)
+        check("load with a 1 minute sleep", ttcfg.transact(port, ttcfg.CONFIG_PUT, one_minute) == b"")
+        check("dump reads the 1 minute sleep back", ttcfg.transact(port, ttcfg.CONFIG_GET) == one_minute)
+
+        check("sleepMs 0 rejected", rejected(port, patch(image, SLEEP, "<I", 0)))
+        check("sleepMs 59999 rejected", rejected(port, patch(image, SLEEP, "<I", 59999)))
+        check("zoomMod 2 rejected", rejected(port, patch(image, ZOOM, "B", 2)))
+        check("batchSep 2 rejected", rejected(port, patch(image, BATCH_SEP, "B", 2)))
+        check("quick bind to macro 99 rejected", rejected(port, patch(image, QBIND, "b", 99)))
+        check("quick bind to a missing formula rejected", rejected(port, patch(image, QBIND, "b", 100 + len(formulas))))
+        check("a rejected load changed nothing", ttcfg.transact(port, ttcfg.CONFIG_GET) == one_minute)
+
+        bound = patch(image, QBIND + 1, "b", 0)
+        check("quick bind FN+1 to the first macro", ttcfg.transact(port, ttcfg.CONFIG_PUT, bound) == b"")
+        check("dump reads the bind back", ttcfg.transact(port, ttcfg.CONFIG_GET) == bound)
+
+        damaged = bytearray(bound)
+        damaged[SLEEP] ^= 0xFF  # CRC left stale
+        check("damaged blob rejected", rejected(port, bytes(damaged)))
+
+        # the device has been left alone: its loop is in a long wait, not polling
+        time.sleep(2)
+        start = time.time()
+        ttcfg.transact(port, ttcfg.CONFIG_GET)
+        took = time.time() - start
+        check(f"idle calc-mode loop answers a frame ({took * 1000:.0f} ms)", took < 0.5)
+        time.sleep(2)
+        check("a frame split across polls isn't timed out", split_frame_reply(port, 0.25))
+    except (OSError, ValueError) as e:
+        check(f"transfer failed: {e}", False)
+    finally:
+        device.kill()
+        device.wait()
+        os.close(master)
+        os.close(slave)
+
+    print(f"ttcfg loopback: {failures} failures")
+    return 1 if failures else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
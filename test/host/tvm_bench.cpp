@@ -0,0 +1,87 @@
+// Host run of the rate solvers over a fixed corpus: random loans solved back
+// for their rate (the corpus "tvmbench" draws on the device), then cash-flow
+// series with a known IRR.
+//
+//   tvm_bench [loans] [irrs]       default 200000 of each
+#include <Arduino.h>
+#include "tvm.h"
+
+static uint64_t rngState = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng() {  // xorshift64*: fixed seed, same corpus every run
+    rngState ^= rngState >> 12;
+    rngState ^= rngState << 25;
+    rngState ^= rngState >> 27;
+    return (uint32_t)((rngState * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+
+struct Tally {
+    long count, failures, fallbacks;
+    uint64_t totalUs, totalIter;
+    uint32_t maxUs, maxIter;
+};
+
+
+static void tally(Tally* t, bool ok, const TvmStats& st) {
+    t->count++;
+    if (!ok) t->failures++;
+    if (st.bisected) t->fallbacks++;
+    t->totalUs += st.micros;
+    t->totalIter += st.iterations;
+    if (st.micros > t->maxUs) t->maxUs = st.micros;
+    if (st.iterations > t->maxIter) t->maxIter = st.iterations;
+}
+
+
+static void report(const char* what, const Tally& t) {
+    if (!t.count) return;
+    printf("%s: %ld solves, %.2f iter avg, %lu max, %.2f us avg, %lu us max\n", what, t.count,
+           (double)t.totalIter / t.count, (unsigned long)t.maxIter,
+           (double)t.totalUs / t.count, (unsigned long)t.maxUs);
+    printf("%s: %ld needed the bisection fallback, %ld failures\n", what, t.fallbacks, t.failures);
+}
+
+
+int main(int argc, char** argv) {
+    long loans = argc > 1 ? atol(argv[1]) : 200000;
+    long irrs = argc > 2 ? atol(argv[2]) : 200000;
+
+    Tally rate = {};
+    for (long k = 0; k < loans; k++) {
+        // 1..480 periods, 0..3% per period, one in four with a balloon payment
+        double n = 1 + rng() % 480;
+        double i = (rng() % 30000) / 1e6;
+        double pv = 100 + rng() % 1000000;
+        double fv = rng() % 4 == 0 ? -pv * (rng() % 50) / 100 : 0;
+        double pmt, solved = 0;
+        TvmStats st = {};
+        if (!tvmPmt(n, i, pv, fv, &pmt)) continue;
+        bool ok = tvmRate(n, pv, pmt, fv, &solved, &st) && fabs(solved - i) <= 1e-8;
+        if (!ok && rate.failures < 5) printf("FAIL rate n=%g i=%g pv=%g fv=%g -> %g\n", n, i, pv, fv, solved);
+        tally(&rate, ok, st);
+    }
+    report("rate", rate);
+
+    Tally irr = {};
+    for (long k = 0; k < irrs; k++) {
+        // 2..16 flows: an outlay, then inflows priced at a known 0..50% rate
+        uint8_t count = 2 + rng() % (TVM_FLOW_MAX - 1);
+        double r = (rng() % 500000) / 1e6;
+        double flows[TVM_FLOW_MAX], outlay = 0, discount = 1;
+        for (uint8_t j = 1; j < count; j++) {
+            discount /= 1 + r;
+            flows[j] = 1 + rng() % 100000;
+            outlay += flows[j] * discount;
+        }
+        flows[0] = -outlay;
+        double solved = 0;
+        TvmStats st = {};
+        bool ok = tvmIrr(flows, count, &solved, &st) && fabs(solved - r) <= 1e-8;
+        if (!ok && irr.failures < 5) printf("FAIL irr count=%u r=%g -> %g\n", count, r, solved);
+        tally(&irr, ok, st);
+    }
+    report("irr", irr);
+
+    return rate.failures || irr.failures ? 1 : 0;
+}
@@ -0,0 +1,102 @@
+#!/usr/bin/env python3
+"""Capture the Tactical Tenkey's current screen over USB serial.
+
+Sends the console "shot" command and saves the 128x64 frame as a binary PBM,
+optionally also as a PNG. With --golden, the capture is compared pixel for
+pixel against a reference PBM and the exit status is 1 on any difference.
+
+    tools/screenshot.py /dev/ttyACM0 calc.pbm
+    tools/screenshot.py /dev/ttyACM0 calc.pbm --png calc.png
+    tools/screenshot.py /dev/ttyACM0 calc.pbm --golden art/golden/calc.pbm
+
+Linux/macOS only (uses termios); no third-party packages needed.
+"""
+import argparse, os, select, struct, sys, termios, time, zlib
+
+WIDTH, HEIGHT = 128, 64
+HEADER = b"P4\n128 64\n"
+FRAME_BYTES = WIDTH * HEIGHT // 8
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    attrs = termios.tcgetattr(fd)
+    attrs[0] = 0                                    # iflag: raw
+    attrs[1] = 0                                    # oflag: raw
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attrs[3] = 0                                    # lflag: no echo/canon
+    attrs[4] = attrs[5] = termios.B115200
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    return fd
+
+
+def read_until(fd, needle, size_after, timeout=3.0):
+    buf = b""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        idx = buf.find(needle)
+        if idx >= 0 and len(buf) >= idx + len(needle) + size_after:
+            start = idx + len(needle)
+            return buf[start:start + size_after]
+        ready, _, _ = select.select([fd], [], [], 0.1)
+        if ready:
+            buf += os.read(fd, 4096)
+    raise TimeoutError("no screenshot received (is the console running?)")
+
+
+def write_png(path, rows):
+    # 1-bit grayscale PNG; PBM uses 1 = black, PNG grayscale uses 1 = white
+    raw = b"".join(b"\x00" + bytes(b ^ 0xFF for b in row) for row in rows)
+    def chunk(kind, data):
+        body = kind + data
+        return struct.pack(">I", len(data)) + body + struct.pack(">I", zlib.crc32(body))
+    png = b"\x89PNG\r\n\x1a\n"
+    png += chunk(b"IHDR", struct.pack(">IIBBBBB", WIDTH, HEIGHT, 1, 0, 0, 0, 0))
+    png += chunk(b"IDAT", zlib.compress(raw))
+    png += chunk(b"IEND", b"")
+    with open(path, "wb") as f:
+        f.write(png)
+
+
+def load_pbm(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if not data.startswith(HEADER) or len(data) != len(HEADER) + FRAME_BYTES:
+        raise ValueError(f"{path}: not a 128x64 binary PBM")
+    return data[len(HEADER):]
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("port")
+    ap.add_argument("out", help="PBM file to write")
+    ap.add_argument("--png", help="also write a PNG")
+    ap.add_argument("--golden", help="reference PBM to compare against")
+    args = ap.parse_args()
+
+    fd = open_port(args.port)
+    try:
+        os.write(fd, b"shot\n")
+        frame = read_until(fd, HEADER, FRAME_BYTES)
+    finally:
+        os.close(fd)
+
+    with open(args.out, "wb") as f:
+        f.write(HEADER + frame)
+    rows = [frame[y * WIDTH // 8:(y + 1) * WIDTH // 8] for y in range(HEIGHT)]
+    if args.png:
+        write_png(args.png, rows)
+
+    if args.golden:
+        golden = load_pbm(args.golden)
+        diff = sum(bin(a ^ b).count("1") for a, b in zip(frame, golden))
+        if diff:
+            print(f"MISMATCH: {diff} pixels differ from {args.golden}")
+            return 1
+        print("match")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,165 @@
+#!/usr/bin/env python3
+"""Dump or load the Tactical Tenkey's whole configuration over USB serial.
+
+The config travels as one binary console frame each way: the settings blob
+exactly as the device stores it (with its own version and CRC) followed by the
+user formulas. A load is checked on the device and applied all or nothing, so
+a fleet can be provisioned from one dumped image.
+
+    tools/ttcfg.py dump /dev/ttyACM0 desk.cfg
+    tools/ttcfg.py load /dev/ttyACM0 desk.cfg
+    tools/ttcfg.py show desk.cfg
+
+Linux/macOS only (uses termios); no third-party packages needed.
+"""
+import argparse, os, select, struct, sys, termios, time, zlib
+
+# console framing (include/console.h):
+#   SOF | version | cmd | length (u16 LE) | payload | CRC32 (LE) of version..payload
+SOF = 0xA5
+FRAME_VERSION = 1
+CONFIG_GET, CONFIG_PUT, CONFIG_REPLY = 0x01, 0x02, 0x80
+STATUS = ["ok", "unknown command", "bad settings (damaged, newer, or out of range)", "bad formulas"]
+
+SETTINGS_HEADER = struct.Struct("<HHI")   # version, payload length, CRC
+SETTINGS_V1 = struct.Struct("<IBBBBB10bB")  # up to the bond list
+BOND = struct.Struct("<6sB")
+BOND_MAX = 9
+ENERGY_ROWS = ["CPU max", "CPU usb", "CPU idle", "Display", "BLE adv", "BLE conn", "Scan", "Sleep"]
+ENERGY = struct.Struct(f"<{len(ENERGY_ROWS)}H")  # v2+, uA per row, after the bond list
+FORMULA = struct.Struct("<6sBBB48s")
+
+
+def open_port(path):
+    fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    attrs = termios.tcgetattr(fd)
+    attrs[0] = 0                                    # iflag: raw
+    attrs[1] = 0                                    # oflag: raw
+    attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+    attrs[3] = 0                                    # lflag: no echo/canon
+    attrs[4] = attrs[5] = termios.B115200
+    termios.tcsetattr(fd, termios.TCSANOW, attrs)
+    termios.tcflush(fd, termios.TCIOFLUSH)
+    return fd
+
+
+def encode_frame(cmd, payload=b""):
+    body = struct.pack("<BBH", FRAME_VERSION, cmd, len(payload)) + payload
+    return bytes([SOF]) + body + struct.pack("<I", zlib.crc32(body))
+
+
+def read_frame(fd, timeout=3.0):
+    # text (perf lines, errors) may come before the reply; skip to the SOF
+    buf = b""
+    deadline = time.time() + timeout
+    while time.time() < deadline:
+        idx = buf.find(bytes([SOF]))
+        if idx >= 0 and len(buf) >= idx + 5:
+            length = struct.unpack_from("<H", buf, idx + 3)[0]
+            end = idx + 5 + length + 4
+            if len(buf) >= end:
+                body = buf[idx + 1:end - 4]
+                if struct.unpack_from("<I", buf, end - 4)[0] != zlib.crc32(body):
+                    raise ValueError("reply frame failed its CRC")
+                return body[1], body[4:]
+        ready, _, _ = select.select([fd], [], [], 0.1)
+        if ready:
+            buf += os.read(fd, 4096)
+    text = buf.decode("ascii", "replace").strip()
+    raise TimeoutError("no reply frame" + (f" (device said: {text})" if text else ""))
+
+
+def transact(port, cmd, payload=b""):
+    fd = open_port(port)
+    try:
+        os.write(fd, b"\n" + encode_frame(cmd, payload))  # newline: start of a line
+        reply_cmd, reply = read_frame(fd)
+    finally:
+        os.close(fd)
+    if reply_cmd != cmd | CONFIG_REPLY or not reply:
+        raise ValueError(f"unexpected reply 0x{reply_cmd:02x}")
+    if reply[0] != 0:
+        status = STATUS[reply[0]] if reply[0] < len(STATUS) else f"status {reply[0]}"
+        raise ValueError(f"device rejected the request: {status}")
+    return reply[1:]
+
+
+def split_image(image):
+    # -> (settings blob, [formula records]); raises on anything the device would reject
+    if len(image) < SETTINGS_HEADER.size:
+        raise ValueError("image too short")
+    version, length, crc = SETTINGS_HEADER.unpack_from(image)
+    blob_end = SETTINGS_HEADER.size + length
+    if len(image) <= blob_end:
+        raise ValueError("image truncated inside the settings blob")
+    if zlib.crc32(image[SETTINGS_HEADER.size:blob_end]) != crc:
+        raise ValueError("settings blob CRC mismatch")
+    count = image[blob_end]
+    records = image[blob_end + 1:]
+    if len(records) != count * FORMULA.size:
+        raise ValueError(f"expected {count} formulas, got {len(records)} bytes")
+    return image[:blob_end], [records[i:i + FORMULA.size] for i in range(0, len(records), FORMULA.size)]
+
+
+def show(image):
+    blob, records = split_image(image)
+    version, length, _ = SETTINGS_HEADER.unpack_from(blob)
+    print(f"settings v{version}, {length} B")
+    fields = SETTINGS_V1.unpack_from(blob, SETTINGS_HEADER.size)
+    sleep_ms, contrast, led, zoom, batch_sep, guided = fields[:6]
+    qbind, bond_count = fields[6:16], fields[16]
+    print(f"  sleep {sleep_ms} ms, contrast {contrast}, led {led}, zoom modifier {zoom}")
+    print(f"  batch separator {'newline' if batch_sep else 'tab'}, guided {bool(guided)}")
+    # v3+: user formulas are bound as MACRO_REF_FORMULA (100) + formula slot
+    binds = [f"{slot}=" + (f"formula{m - 100}" if version >= 3 and m >= 100 else str(m))
+             for slot, m in enumerate(qbind) if m >= 0]
+    print("  quick binds: " + " ".join(binds))
+    offset = SETTINGS_HEADER.size + SETTINGS_V1.size
+    for i in range(min(bond_count, BOND_MAX)):
+        mac, os_id = BOND.unpack_from(blob, offset + i * BOND.size)
+        print(f"  bond {':'.join(f'{b:02x}' for b in mac)} os {os_id}")
+    offset += BOND_MAX * BOND.size
+    offset += offset % 2  # the compiler aligns the uint16 array
+    if version >= 2 and len(blob) >= offset + ENERGY.size:
+        coefs = ENERGY.unpack_from(blob, offset)
+        print("  current (uA): " + ", ".join(f"{n} {ua}" for n, ua in zip(ENERGY_ROWS, coefs)))
+    for rec in records:
+        name, params, _, code_len, _ = FORMULA.unpack(rec)
+        name = name.split(b"\0")[0].decode()
+        print(f"  formula {name}: {params} params, {code_len} B bytecode")
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    sub = ap.add_subparsers(dest="action", required=True)
+    for name in ("dump", "load"):
+        p = sub.add_parser(name)
+        p.add_argument("port")
+        p.add_argument("file")
+    sub.add_parser("show").add_argument("file")
+    args = ap.parse_args()
+
+    try:
+        if args.action == "dump":
+            image = transact(args.port, CONFIG_GET)
+            split_image(image)
+            with open(args.file, "wb") as f:
+                f.write(image)
+            print(f"{len(image)} B written to {args.file}")
+        else:
+            with open(args.file, "rb") as f:
+                image = f.read()
+            if args.action == "show":
+                show(image)
+            else:
+                split_image(image)
+                transact(args.port, CONFIG_PUT, image)
+                print(f"loaded {len(image)} B")
+    except (OSError, ValueError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())